@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2020 Erik Rigtorp <erik@rigtorp.se>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef __linux__
+#error "HugePageAllocator requires Linux"
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rigtorp {
+namespace mpmc {
+
+/// Allocator that maps memory directly with mmap, intended for the slot array
+/// of large queues. Plugs into the Allocator template parameter of Queue:
+///
+///   MPMCQueue<T, HugePageAllocator<Slot<T>>> q(n, HugePageAllocator<...>(0));
+///
+/// - Tries explicit huge pages (MAP_HUGETLB) first and falls back to regular
+///   pages with a transparent huge page hint (MADV_HUGEPAGE).
+/// - Optionally binds the mapping to a NUMA node (mbind with MPOL_BIND).
+/// - Optionally pre-faults all pages so that the first pushes don't stall.
+template <typename T> struct HugePageAllocator {
+  using value_type = T;
+
+  static constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+  static constexpr std::size_t pageSize = 4096;
+
+  explicit HugePageAllocator(int numaNode = -1, bool prefault = true) noexcept
+      : numaNode(numaNode), prefault(prefault) {}
+
+  template <typename U>
+  HugePageAllocator(const HugePageAllocator<U> &other) noexcept
+      : numaNode(other.numaNode), prefault(other.prefault) {}
+
+  T *allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    auto const size = mappingSize(n);
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED) {
+      // No huge pages reserved (or unsupported size), fall back to regular
+      // pages and ask for transparent huge pages instead
+      p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+#ifdef MADV_HUGEPAGE
+      madvise(p, size, MADV_HUGEPAGE);
+#endif
+    }
+    if (numaNode >= 0) {
+      bind(p, size);
+    }
+    if (prefault) {
+      // Pages are faulted in after binding so they land on the right node
+      auto *bytes = static_cast<volatile char *>(p);
+      for (std::size_t i = 0; i < size; i += pageSize) {
+        bytes[i] = 0;
+      }
+    }
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, std::size_t n) noexcept { munmap(p, mappingSize(n)); }
+
+  // The rounded size is the same whether or not huge pages were obtained, so
+  // deallocate doesn't need to know which kind of mapping was made
+  static std::size_t mappingSize(std::size_t n) noexcept {
+    return (sizeof(T) * n + hugePageSize - 1) / hugePageSize * hugePageSize;
+  }
+
+  int numaNode;
+  bool prefault;
+
+private:
+  void bind(void *p, std::size_t size) const {
+    static constexpr int mpolBind = 2; // MPOL_BIND from <numaif.h>
+    static constexpr std::size_t maskBits = 8 * sizeof(unsigned long);
+    unsigned long mask[16] = {};
+    if (static_cast<std::size_t>(numaNode) >= maskBits * 16) {
+      munmap(p, size);
+      throw std::system_error(EINVAL, std::generic_category(), "mbind");
+    }
+    mask[numaNode / maskBits] = 1UL << (numaNode % maskBits);
+    // Raw syscall to avoid a link time dependency on libnuma
+    if (syscall(SYS_mbind, p, size, mpolBind, mask, maskBits * 16 + 1, 0) !=
+        0) {
+      auto const err = errno;
+      // Kernel without NUMA support, node 0 is the only node
+      if (err == ENOSYS && numaNode == 0) {
+        return;
+      }
+      munmap(p, size);
+      throw std::system_error(err, std::generic_category(), "mbind");
+    }
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T> &a,
+                const HugePageAllocator<U> &b) noexcept {
+  return a.numaNode == b.numaNode && a.prefault == b.prefault;
+}
+
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T> &a,
+                const HugePageAllocator<U> &b) noexcept {
+  return !(a == b);
+}
+
+} // namespace mpmc
+} // namespace rigtorp
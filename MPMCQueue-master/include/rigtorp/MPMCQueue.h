@@ -22,13 +22,20 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm> // std::min
 #include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef> // offsetof
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <new> // std::hardware_destructive_interference_size
 #include <stdexcept>
+#include <thread>
 
 #ifndef __cpp_aligned_new
 #ifdef _WIN32
@@ -82,8 +89,8 @@ template <typename T> struct AlignedAllocator {
 };
 #endif
 
-template <typename T> struct Slot {
-  ~Slot() noexcept {
+template <typename T, size_t Align> struct BasicSlot {
+  ~BasicSlot() noexcept {
     if (turn & 1) {
       destroy();
     }
@@ -103,14 +110,85 @@ template <typename T> struct Slot {
 
   T &&move() noexcept { return reinterpret_cast<T &&>(storage); }
 
-  // Align to avoid false sharing between adjacent slots
-  alignas(hardwareInterferenceSize) std::atomic<size_t> turn = {0};
+  alignas(Align) std::atomic<uint64_t> turn = {0};
   typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
 };
 
-template <typename T, typename Allocator = AlignedAllocator<Slot<T>>>
+// Align to avoid false sharing between adjacent slots
+template <typename T>
+using Slot = BasicSlot<T, hardwareInterferenceSize>;
+
+// Unpadded slot, several adjacent slots share a cache line
+template <typename T>
+using CompactSlot = BasicSlot<T, alignof(std::atomic<uint64_t>)>;
+
+constexpr size_t ilog2(size_t n) noexcept {
+  return n < 2 ? 0 : 1 + ilog2(n / 2);
+}
+
+/// Default layout. Every slot is padded to a multiple of the cache line size
+/// so that producers and consumers working on adjacent tickets never share a
+/// cache line.
+struct PaddedLayout {
+  template <typename T> using slot_type = Slot<T>;
+
+  static constexpr bool padded = true;
+
+  template <typename T>
+  static constexpr size_t slotCount(size_t capacity) noexcept {
+    return capacity;
+  }
+
+  template <typename T> static constexpr size_t remap(size_t i) noexcept {
+    return i;
+  }
+};
+
+/// Memory dense layout. Slots are not padded, so a queue of small elements
+/// uses up to hardwareInterferenceSize / sizeof(T) times less memory. To keep
+/// most of the false sharing protection the slot index is scrambled: within
+/// each block of L * L slots (L = slots per cache line) the low 2 * log2(L)
+/// index bits are rotated by log2(L), so that L consecutive tickets land on L
+/// different cache lines. The slot array is rounded up to a whole block.
+struct CompactLayout {
+  template <typename T> using slot_type = CompactSlot<T>;
+
+  static constexpr bool padded = false;
+
+  template <typename T> static constexpr size_t shuffleBits() noexcept {
+    return ilog2(hardwareInterferenceSize / sizeof(CompactSlot<T>));
+  }
+
+  template <typename T> static constexpr size_t blockSize() noexcept {
+    return size_t(1) << 2 * shuffleBits<T>();
+  }
+
+  template <typename T>
+  static constexpr size_t slotCount(size_t capacity) noexcept {
+    return (capacity + blockSize<T>() - 1) / blockSize<T>() * blockSize<T>();
+  }
+
+  template <typename T> static constexpr size_t remap(size_t i) noexcept {
+    return remap(i, shuffleBits<T>(),
+                 (i ^ (i >> shuffleBits<T>())) &
+                     ((size_t(1) << shuffleBits<T>()) - 1));
+  }
+
+private:
+  static constexpr size_t remap(size_t i, size_t bits, size_t mix) noexcept {
+    return i ^ mix ^ (mix << bits);
+  }
+};
+
+template <typename T, typename Allocator = AlignedAllocator<Slot<T>>,
+          typename Layout = PaddedLayout>
 class Queue {
 private:
+  using slot_type = typename Layout::template slot_type<T>;
+
+  static_assert(std::is_same<typename Allocator::value_type, slot_type>::value,
+                "Allocator must allocate the slot type of the layout");
+
   static_assert(std::is_nothrow_copy_assignable<T>::value ||
                     std::is_nothrow_move_assignable<T>::value,
                 "T must be nothrow copy or move assignable");
@@ -121,26 +199,28 @@ private:
 public:
   explicit Queue(const size_t capacity,
                  const Allocator &allocator = Allocator())
-      : capacity_(capacity), allocator_(allocator), head_(0), tail_(0) {
+      : capacity_(capacity), sampleMask_(sampleMask(capacity)),
+        allocator_(allocator), head_(0), tail_(0) {
     if (capacity_ < 1) {
       throw std::invalid_argument("capacity < 1");
     }
     // Allocate one extra slot to prevent false sharing on the last slot
-    slots_ = allocator_.allocate(capacity_ + 1);
+    slots_ = allocator_.allocate(slotCount() + 1);
     // Allocators are not required to honor alignment for over-aligned types
     // (see http://eel.is/c++draft/allocator.requirements#10) so we verify
     // alignment here
-    if (reinterpret_cast<size_t>(slots_) % alignof(Slot<T>) != 0) {
-      allocator_.deallocate(slots_, capacity_ + 1);
+    if (reinterpret_cast<size_t>(slots_) % alignof(slot_type) != 0) {
+      allocator_.deallocate(slots_, slotCount() + 1);
       throw std::bad_alloc();
     }
-    for (size_t i = 0; i < capacity_; ++i) {
-      new (&slots_[i]) Slot<T>();
+    for (size_t i = 0; i < slotCount(); ++i) {
+      new (&slots_[i]) slot_type();
     }
     static_assert(
-        alignof(Slot<T>) == hardwareInterferenceSize,
+        !Layout::padded || alignof(slot_type) == hardwareInterferenceSize,
         "Slot must be aligned to cache line boundary to prevent false sharing");
-    static_assert(sizeof(Slot<T>) % hardwareInterferenceSize == 0,
+    static_assert(!Layout::padded ||
+                      sizeof(slot_type) % hardwareInterferenceSize == 0,
                   "Slot size must be a multiple of cache line size to prevent "
                   "false sharing between adjacent slots");
     static_assert(sizeof(Queue) % hardwareInterferenceSize == 0,
@@ -153,10 +233,11 @@ public:
   }
 
   ~Queue() noexcept {
-    for (size_t i = 0; i < capacity_; ++i) {
-      slots_[i].~Slot();
+    for (size_t i = 0; i < slotCount(); ++i) {
+      slots_[i].~slot_type();
     }
-    allocator_.deallocate(slots_, capacity_ + 1);
+    allocator_.deallocate(slots_, slotCount() + 1);
+    delete watermarks_.callbacks;
   }
 
   // non-copyable and non-movable
@@ -171,7 +252,10 @@ public:
     while (turn(head) * 2 != slot.turn.load(std::memory_order_acquire))
       ;
     slot.construct(std::forward<Args>(args)...);
+    countEnqueue();
     slot.turn.store(turn(head) * 2 + 1, std::memory_order_release);
+    wake(popWaiters_);
+    sampleHigh(head);
   }
 
   template <typename... Args> bool try_emplace(Args &&...args) noexcept {
@@ -183,7 +267,10 @@ public:
       if (turn(head) * 2 == slot.turn.load(std::memory_order_acquire)) {
         if (head_.compare_exchange_strong(head, head + 1)) {
           slot.construct(std::forward<Args>(args)...);
+          countEnqueue();
           slot.turn.store(turn(head) * 2 + 1, std::memory_order_release);
+          wake(popWaiters_);
+          sampleHigh(head);
           return true;
         }
       } else {
@@ -229,7 +316,10 @@ public:
       ;
     v = slot.move();
     slot.destroy();
+    countDequeue();
     slot.turn.store(turn(tail) * 2 + 2, std::memory_order_release);
+    wake(pushWaiters_);
+    sampleLow(tail);
   }
 
   bool try_pop(T &v) noexcept {
@@ -240,7 +330,10 @@ public:
         if (tail_.compare_exchange_strong(tail, tail + 1)) {
           v = slot.move();
           slot.destroy();
+          countDequeue();
           slot.turn.store(turn(tail) * 2 + 2, std::memory_order_release);
+          wake(pushWaiters_);
+          sampleLow(tail);
           return true;
         }
       } else {
@@ -253,14 +346,69 @@ public:
     }
   }
 
+  /// Try to enqueue until the deadline. Spins for a short while and then
+  /// parks the thread until space becomes available or the deadline passes.
+  /// A timed out call leaves the queue untouched, no ticket is claimed.
+  template <typename Clock, typename Duration>
+  bool try_push_until(const T &v,
+                      const std::chrono::time_point<Clock, Duration> &deadline) {
+    static_assert(std::is_nothrow_copy_constructible<T>::value,
+                  "T must be nothrow copy constructible");
+    return wait_until(
+        pushWaiters_, deadline, [&] { return try_emplace(v); },
+        [&] { return full(); });
+  }
+
+  template <typename P, typename Clock, typename Duration,
+            typename = typename std::enable_if<
+                std::is_nothrow_constructible<T, P &&>::value>::type>
+  bool try_push_until(P &&v,
+                      const std::chrono::time_point<Clock, Duration> &deadline) {
+    return wait_until(
+        pushWaiters_, deadline,
+        [&] { return try_emplace(std::forward<P>(v)); },
+        [&] { return full(); });
+  }
+
+  template <typename Rep, typename Period>
+  bool try_push_for(const T &v,
+                    const std::chrono::duration<Rep, Period> &timeout) {
+    return try_push_until(v, std::chrono::steady_clock::now() + timeout);
+  }
+
+  template <typename P, typename Rep, typename Period,
+            typename = typename std::enable_if<
+                std::is_nothrow_constructible<T, P &&>::value>::type>
+  bool try_push_for(P &&v, const std::chrono::duration<Rep, Period> &timeout) {
+    return try_push_until(std::forward<P>(v),
+                          std::chrono::steady_clock::now() + timeout);
+  }
+
+  /// Try to dequeue until the deadline. Spins for a short while and then
+  /// parks the thread until an element becomes available or the deadline
+  /// passes. A timed out call leaves the queue untouched, no ticket is claimed.
+  template <typename Clock, typename Duration>
+  bool try_pop_until(T &v,
+                     const std::chrono::time_point<Clock, Duration> &deadline) {
+    return wait_until(
+        popWaiters_, deadline, [&] { return try_pop(v); },
+        [&] { return claimed() <= 0; });
+  }
+
+  template <typename Rep, typename Period>
+  bool try_pop_for(T &v, const std::chrono::duration<Rep, Period> &timeout) {
+    return try_pop_until(v, std::chrono::steady_clock::now() + timeout);
+  }
+
   /// Returns the number of elements in the queue.
   /// The size can be negative when the queue is empty and there is at least one
   /// reader waiting. Since this is a concurrent queue the size is only a best
   /// effort guess until all reader and writer threads have been joined.
+  /// Tickets are 64 bit on all platforms so the difference never wraps.
   ptrdiff_t size() const noexcept {
-    // TODO: How can we deal with wrapped queue on 32bit?
-    return static_cast<ptrdiff_t>(head_.load(std::memory_order_relaxed) -
-                                  tail_.load(std::memory_order_relaxed));
+    return static_cast<ptrdiff_t>(
+        static_cast<int64_t>(head_.load(std::memory_order_relaxed) -
+                             tail_.load(std::memory_order_relaxed)));
   }
 
   /// Returns true if the queue is empty.
@@ -268,14 +416,238 @@ public:
   /// until all reader and writer threads have been joined.
   bool empty() const noexcept { return size() <= 0; }
 
+  /// Returns the number of bytes requested from the allocator for the slot
+  /// array: the layout's slot count (rounded up to whole blocks for the
+  /// compact layout) plus one padding slot. The allocator may map more.
+  size_t allocatedSize() const noexcept {
+    return sizeof(slot_type) * (slotCount() + 1);
+  }
+
+  /// Returns the number of completed enqueue operations. Monotonic.
+  /// Counted in per-thread stripes, so it adds no contention to head or tail.
+  uint64_t enqueued() const noexcept {
+    uint64_t n = 0;
+    for (auto const &stripe : stats_) {
+      n += stripe.enqueued.load(std::memory_order_acquire);
+    }
+    return n;
+  }
+
+  /// Returns the number of completed dequeue operations. Monotonic.
+  uint64_t dequeued() const noexcept {
+    uint64_t n = 0;
+    for (auto const &stripe : stats_) {
+      n += stripe.dequeued.load(std::memory_order_acquire);
+    }
+    return n;
+  }
+
+  /// Returns the number of elements in the queue based on completed
+  /// operations. Unlike size() it is never negative and never exceeds the
+  /// capacity, readers or writers blocked on the queue are not counted.
+  size_t occupancy() const noexcept {
+    // Dequeues are read first: an element is counted as enqueued before it
+    // can be dequeued, so this never underflows
+    auto const deq = dequeued();
+    auto const enq = enqueued();
+    return enq - deq < capacity_ ? static_cast<size_t>(enq - deq) : capacity_;
+  }
+
+  /// Returns the highest occupancy observed since construction or the last
+  /// resetHighWatermark(). Occupancy is sampled from the tickets on every
+  /// enqueue for queues of up to 16 slots, then every 2nd, 4th and 8th
+  /// enqueue up to 32, 64 and 128 slots and every 16th beyond that, so a
+  /// peak shorter than the sampling period can be missed.
+  size_t highWatermark() const noexcept {
+    return watermarks_.high.load(std::memory_order_relaxed);
+  }
+
+  void resetHighWatermark() noexcept {
+    watermarks_.high.store(0, std::memory_order_relaxed);
+  }
+
+  /// Registers callbacks for when the occupancy rises to at least `high` and
+  /// when it afterwards falls to at most `low`. Each callback fires at most
+  /// once per crossing, on the thread whose enqueue or dequeue observed it,
+  /// using the same sampling as highWatermark(); a crossing that reverts
+  /// between two samples fires nothing. Callbacks must not throw or block.
+  /// Not thread safe, call before the queue is shared.
+  void setWatermarkCallbacks(size_t high, std::function<void(size_t)> onHigh,
+                             size_t low, std::function<void(size_t)> onLow) {
+    if (low >= high) {
+      throw std::invalid_argument("low >= high");
+    }
+    if (!watermarks_.callbacks) {
+      watermarks_.callbacks = new Callbacks;
+    }
+    watermarks_.highMark = high;
+    watermarks_.lowMark = low;
+    watermarks_.callbacks->onHigh = std::move(onHigh);
+    watermarks_.callbacks->onLow = std::move(onLow);
+    watermarks_.above.store(false, std::memory_order_relaxed);
+  }
+
 private:
-  constexpr size_t idx(size_t i) const noexcept { return i % capacity_; }
+  // Threads parked by the timed operations. Waiters register in count before
+  // they re-check the queue; push and pop read count after their seq_cst RMW
+  // on head_ or tail_, so either the waiter sees the new ticket or the waker
+  // sees the waiter. When nobody is parked a wake costs one load.
+  struct Waiters {
+    std::atomic<size_t> count = {0};
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  static constexpr int spinCount = 128;
+
+  static void wake(Waiters &waiters) noexcept {
+    if (waiters.count.load() != 0) {
+      std::lock_guard<std::mutex> lock(waiters.mutex);
+      waiters.cv.notify_all();
+    }
+  }
+
+  template <typename Clock, typename Duration, typename TryOp,
+            typename MustWait>
+  bool wait_until(Waiters &waiters,
+                  const std::chrono::time_point<Clock, Duration> &deadline,
+                  TryOp tryOp, MustWait mustWait) {
+    for (int i = 0; i < spinCount; ++i) {
+      if (tryOp()) {
+        return true;
+      }
+    }
+    for (;;) {
+      if (tryOp()) {
+        return true;
+      }
+      if (Clock::now() >= deadline) {
+        return false;
+      }
+      std::unique_lock<std::mutex> lock(waiters.mutex);
+      waiters.count.fetch_add(1);
+      if (mustWait()) {
+        waiters.cv.wait_until(lock, deadline);
+        waiters.count.fetch_sub(1);
+      } else {
+        // A ticket is claimed but not yet published, it won't be long
+        waiters.count.fetch_sub(1);
+        lock.unlock();
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Like size() but with seq_cst loads, as required by Waiters
+  ptrdiff_t claimed() const noexcept {
+    return static_cast<ptrdiff_t>(
+        static_cast<int64_t>(head_.load() - tail_.load()));
+  }
+
+  bool full() const noexcept {
+    return claimed() >= static_cast<ptrdiff_t>(capacity_);
+  }
 
-  constexpr size_t turn(size_t i) const noexcept { return i / capacity_; }
+  // Completed operations are counted in per-thread stripes on their own cache
+  // lines. The enqueue count is bumped before the slot is published and the
+  // dequeue count with release, so enqueued() >= dequeued() for any reader
+  // that loads dequeued() first.
+  static constexpr size_t statsStripes = 8;
+
+  struct alignas(hardwareInterferenceSize) StatsStripe {
+    std::atomic<uint64_t> enqueued = {0};
+    std::atomic<uint64_t> dequeued = {0};
+  };
+
+  static size_t stripe() noexcept {
+    static std::atomic<size_t> next = {0};
+    static thread_local size_t const index =
+        next.fetch_add(1, std::memory_order_relaxed) % statsStripes;
+    return index;
+  }
+
+  void countEnqueue() noexcept {
+    stats_[stripe()].enqueued.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void countDequeue() noexcept {
+    stats_[stripe()].dequeued.fetch_add(1, std::memory_order_release);
+  }
+
+  // Watermarks are sampled from the tickets. Only every (sampleMask_ + 1)th
+  // operation reads the opposite index, which keeps the extra cache line
+  // traffic on head_ and tail_ negligible.
+  struct Callbacks {
+    std::function<void(size_t)> onHigh;
+    std::function<void(size_t)> onLow;
+  };
+
+  // Callbacks live out of line to keep Queue standard layout
+  struct Watermarks {
+    std::atomic<size_t> high = {0};
+    std::atomic<bool> above = {false};
+    size_t highMark = 0;
+    size_t lowMark = 0;
+    Callbacks *callbacks = nullptr;
+  };
+
+  // Sampling period: 1 up to 16 slots, 2 up to 32, 4 up to 64, 8 up to 128,
+  // 16 beyond. Roughly capacity / 8, so a sample is taken a few times per lap.
+  static constexpr uint64_t sampleMask(size_t capacity) noexcept {
+    return capacity >= 256  ? 15
+           : capacity >= 16 ? 15 >> ilog2(256 / capacity)
+                            : 0;
+  }
+
+  void sampleHigh(uint64_t head) noexcept {
+    if ((head & sampleMask_) != 0) {
+      return;
+    }
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    if (static_cast<int64_t>(head + 1 - tail) <= 0) {
+      return;
+    }
+    auto const occupied =
+        static_cast<size_t>(std::min<uint64_t>(head + 1 - tail, capacity_));
+    auto high = watermarks_.high.load(std::memory_order_relaxed);
+    while (occupied > high && !watermarks_.high.compare_exchange_weak(
+                                  high, occupied, std::memory_order_relaxed)) {
+    }
+    if (watermarks_.callbacks && occupied >= watermarks_.highMark &&
+        !watermarks_.above.load(std::memory_order_relaxed) &&
+        !watermarks_.above.exchange(true) && watermarks_.callbacks->onHigh) {
+      watermarks_.callbacks->onHigh(occupied);
+    }
+  }
+
+  void sampleLow(uint64_t tail) noexcept {
+    if ((tail & sampleMask_) != 0 ||
+        !watermarks_.above.load(std::memory_order_relaxed)) {
+      return;
+    }
+    auto const head = head_.load(std::memory_order_relaxed);
+    auto const occupied =
+        static_cast<int64_t>(head - tail - 1) > 0 ? head - tail - 1 : 0;
+    if (occupied <= watermarks_.lowMark && watermarks_.above.exchange(false) &&
+        watermarks_.callbacks->onLow) {
+      watermarks_.callbacks->onLow(static_cast<size_t>(occupied));
+    }
+  }
+
+  constexpr size_t idx(uint64_t i) const noexcept {
+    return Layout::template remap<T>(static_cast<size_t>(i % capacity_));
+  }
+
+  constexpr size_t slotCount() const noexcept {
+    return Layout::template slotCount<T>(capacity_);
+  }
+
+  constexpr uint64_t turn(uint64_t i) const noexcept { return i / capacity_; }
 
 private:
   const size_t capacity_;
-  Slot<T> *slots_;
+  const uint64_t sampleMask_;
+  slot_type *slots_;
 #if defined(__has_cpp_attribute) && __has_cpp_attribute(no_unique_address)
   Allocator allocator_ [[no_unique_address]];
 #else
@@ -283,8 +655,14 @@ private:
 #endif
 
   // Align to avoid false sharing between head_ and tail_
-  alignas(hardwareInterferenceSize) std::atomic<size_t> head_;
-  alignas(hardwareInterferenceSize) std::atomic<size_t> tail_;
+  alignas(hardwareInterferenceSize) std::atomic<uint64_t> head_;
+  alignas(hardwareInterferenceSize) std::atomic<uint64_t> tail_;
+
+  alignas(hardwareInterferenceSize) Waiters pushWaiters_;
+  Waiters popWaiters_;
+
+  StatsStripe stats_[statsStripes];
+  alignas(hardwareInterferenceSize) Watermarks watermarks_;
 };
 } // namespace mpmc
 
@@ -292,4 +670,8 @@ template <typename T,
           typename Allocator = mpmc::AlignedAllocator<mpmc::Slot<T>>>
 using MPMCQueue = mpmc::Queue<T, Allocator>;
 
+template <typename T,
+          typename Allocator = mpmc::AlignedAllocator<mpmc::CompactSlot<T>>>
+using CompactMPMCQueue = mpmc::Queue<T, Allocator, mpmc::CompactLayout>;
+
 } // namespace rigtorp
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <rigtorp/MPMCQueue.h>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <rigtorp/HugePageAllocator.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Usage: MPMCQueueBenchmark [capacity] [threads per side] [ops] [numa node]
+//
+// Measures throughput of numThreads producers and numThreads consumers
+// passing uint64_t through a queue, together with the memory the slot array
+// of each queue variant occupies. On Linux the slot array is also mapped with
+// HugePageAllocator and dTLB load misses are reported when perf events are
+// available.
+
+#ifdef __linux__
+// Counts dTLB load misses of this thread and all threads it spawns
+class TlbMissCounter {
+public:
+  TlbMissCounter() {
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  ~TlbMissCounter() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+  // Returns -1 if perf events are not available
+  long long read() const {
+    long long count = -1;
+    if (fd_ < 0 || ::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+      return -1;
+    }
+    return count;
+  }
+
+private:
+  int fd_;
+};
+#else
+struct TlbMissCounter {
+  long long read() const { return -1; }
+};
+#endif
+
+template <typename Queue>
+double throughput(Queue &q, size_t numThreads, uint64_t numOps) {
+  std::atomic<bool> flag(false);
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> sum(0);
+  for (size_t i = 0; i < numThreads; ++i) {
+    threads.push_back(std::thread([&, i] {
+      while (!flag)
+        ;
+      for (auto j = i; j < numOps; j += numThreads) {
+        q.push(j);
+      }
+    }));
+  }
+  for (size_t i = 0; i < numThreads; ++i) {
+    threads.push_back(std::thread([&, i] {
+      while (!flag)
+        ;
+      uint64_t threadSum = 0;
+      for (auto j = i; j < numOps; j += numThreads) {
+        uint64_t v;
+        q.pop(v);
+        threadSum += v;
+      }
+      sum += threadSum;
+    }));
+  }
+  auto const start = std::chrono::steady_clock::now();
+  flag = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto const stop = std::chrono::steady_clock::now();
+  if (sum != numOps * (numOps - 1) / 2) {
+    std::cerr << "checksum mismatch" << std::endl;
+    std::exit(1);
+  }
+  return numOps / std::chrono::duration<double>(stop - start).count();
+}
+
+// Bytes the allocator actually reserves for an allocation of `bytes`. The
+// default allocator's own rounding is at most a page and is ignored
+size_t mappedSize(size_t bytes) { return bytes; }
+
+#ifdef __linux__
+template <typename T>
+size_t mappedSize(size_t bytes, const rigtorp::mpmc::HugePageAllocator<T> &) {
+  return rigtorp::mpmc::HugePageAllocator<T>::mappingSize(bytes / sizeof(T));
+}
+#endif
+
+template <typename Queue, typename Slot, typename... Allocator>
+void run(const char *name, size_t capacity, size_t numThreads, uint64_t numOps,
+         const Allocator &...allocator) {
+  Queue q(capacity, allocator...);
+  // Fill and drain once so every slot has been touched before timing
+  for (size_t i = 0; i < capacity; ++i) {
+    q.push(i);
+  }
+  for (size_t i = 0; i < capacity; ++i) {
+    uint64_t v;
+    q.pop(v);
+  }
+  TlbMissCounter tlbMisses;
+  auto const ops = throughput(q, numThreads, numOps);
+  auto const misses = tlbMisses.read();
+  auto const bytes = mappedSize(q.allocatedSize(), allocator...);
+  std::cout << name << ": " << sizeof(Slot) << " bytes/slot, "
+            << static_cast<double>(bytes) / (1024 * 1024) << " MiB, "
+            << static_cast<uint64_t>(ops) << " ops/s, ";
+  if (misses >= 0) {
+    std::cout << misses << " dTLB misses" << std::endl;
+  } else {
+    std::cout << "dTLB misses n/a" << std::endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  using namespace rigtorp;
+
+  size_t const capacity = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                   : 1024 * 1024;
+  size_t const numThreads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2;
+  uint64_t const numOps =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000000;
+  int const numaNode = argc > 4 ? std::atoi(argv[4]) : -1;
+
+  std::cout << "capacity " << capacity << ", " << numThreads
+            << " producers, " << numThreads << " consumers, " << numOps
+            << " ops" << std::endl;
+
+  run<MPMCQueue<uint64_t>, mpmc::Slot<uint64_t>>("padded          ", capacity,
+                                                 numThreads, numOps);
+  run<CompactMPMCQueue<uint64_t>, mpmc::CompactSlot<uint64_t>>(
+      "compact         ", capacity, numThreads, numOps);
+
+#ifdef __linux__
+  using HugeSlotAllocator = mpmc::HugePageAllocator<mpmc::Slot<uint64_t>>;
+  using HugeCompactSlotAllocator =
+      mpmc::HugePageAllocator<mpmc::CompactSlot<uint64_t>>;
+  run<MPMCQueue<uint64_t, HugeSlotAllocator>, mpmc::Slot<uint64_t>>(
+      "padded  hugepage", capacity, numThreads, numOps,
+      HugeSlotAllocator(numaNode));
+  run<CompactMPMCQueue<uint64_t, HugeCompactSlotAllocator>,
+      mpmc::CompactSlot<uint64_t>>("compact hugepage", capacity, numThreads,
+                                   numOps, HugeCompactSlotAllocator(numaNode));
+#else
+  (void)numaNode;
+#endif
+
+  return 0;
+}
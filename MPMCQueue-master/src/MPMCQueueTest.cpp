@@ -26,6 +26,9 @@ SOFTWARE.
 #include <chrono>
 #include <iostream>
 #include <rigtorp/MPMCQueue.h>
+#ifdef __linux__
+#include <rigtorp/HugePageAllocator.h>
+#endif
 #include <set>
 #include <thread>
 #include <vector>
@@ -67,6 +70,82 @@ struct TestType {
 
 std::set<const TestType *> TestType::constructed;
 
+// Multithreaded test that all elements are enqueued and dequeued correctly
+// under heavy contention
+template <typename Queue> void fuzz() {
+  const uint64_t numOps = 1000;
+  const uint64_t numThreads = 10;
+  Queue q(numThreads);
+  std::atomic<bool> flag(false);
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> sum(0);
+  for (uint64_t i = 0; i < numThreads; ++i) {
+    threads.push_back(std::thread([&, i] {
+      while (!flag)
+        ;
+      for (auto j = i; j < numOps; j += numThreads) {
+        q.push(j);
+      }
+    }));
+  }
+  for (uint64_t i = 0; i < numThreads; ++i) {
+    threads.push_back(std::thread([&, i] {
+      while (!flag)
+        ;
+      uint64_t threadSum = 0;
+      for (auto j = i; j < numOps; j += numThreads) {
+        uint64_t v;
+        q.pop(v);
+        threadSum += v;
+      }
+      sum += threadSum;
+    }));
+  }
+  flag = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  assert(sum == numOps * (numOps - 1) / 2);
+  assert(q.enqueued() == numOps && q.dequeued() == numOps);
+  assert(q.occupancy() == 0 && q.highWatermark() <= numThreads);
+}
+
+// Same as fuzz but with the timed operations and short timeouts, so that
+// threads keep timing out and parking
+template <typename Queue> void fuzzTimed() {
+  const uint64_t numOps = 1000;
+  const uint64_t numThreads = 10;
+  const auto timeout = std::chrono::microseconds(100);
+  Queue q(2);
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> sum(0);
+  for (uint64_t i = 0; i < numThreads; ++i) {
+    threads.push_back(std::thread([&, i] {
+      for (auto j = i; j < numOps; j += numThreads) {
+        while (!q.try_push_for(j, timeout))
+          ;
+      }
+    }));
+  }
+  for (uint64_t i = 0; i < numThreads; ++i) {
+    threads.push_back(std::thread([&, i] {
+      uint64_t threadSum = 0;
+      for (auto j = i; j < numOps; j += numThreads) {
+        uint64_t v;
+        while (!q.try_pop_for(v, timeout))
+          ;
+        threadSum += v;
+      }
+      sum += threadSum;
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  assert(sum == numOps * (numOps - 1) / 2);
+  assert(q.size() == 0);
+}
+
 int main(int argc, char *argv[]) {
   (void)argc, (void)argv;
 
@@ -152,42 +231,150 @@ int main(int argc, char *argv[]) {
     assert(throws == true);
   }
 
-  // Fuzz test
+  // Compact layout
   {
-    const uint64_t numOps = 1000;
-    const uint64_t numThreads = 10;
-    MPMCQueue<uint64_t> q(numThreads);
-    std::atomic<bool> flag(false);
-    std::vector<std::thread> threads;
-    std::atomic<uint64_t> sum(0);
-    for (uint64_t i = 0; i < numThreads; ++i) {
-      threads.push_back(std::thread([&, i] {
-        while (!flag)
-          ;
-        for (auto j = i; j < numOps; j += numThreads) {
-          q.push(j);
-        }
-      }));
+    CompactMPMCQueue<TestType> q(11);
+    for (int i = 0; i < 10; i++) {
+      q.emplace();
     }
-    for (uint64_t i = 0; i < numThreads; ++i) {
-      threads.push_back(std::thread([&, i] {
-        while (!flag)
-          ;
-        uint64_t threadSum = 0;
-        for (auto j = i; j < numOps; j += numThreads) {
-          uint64_t v;
-          q.pop(v);
-          threadSum += v;
-        }
-        sum += threadSum;
-      }));
+    assert(q.size() == 10 && !q.empty());
+    assert(TestType::constructed.size() == 10);
+    TestType t;
+    q.pop(t);
+    assert(q.size() == 9);
+    assert(TestType::constructed.size() == 10);
+  }
+  assert(TestType::constructed.size() == 0);
+
+  {
+    // 16 byte slots, 4 per cache line: a block of 16 slots is permuted so
+    // that 4 consecutive tickets never share a cache line
+    const size_t n = mpmc::CompactLayout::blockSize<uint64_t>();
+    std::set<size_t> seen;
+    for (size_t i = 0; i < n; ++i) {
+      auto j = mpmc::CompactLayout::remap<uint64_t>(i);
+      assert(j < n);
+      seen.insert(j);
+      if (i % 4 != 0) {
+        auto prev = mpmc::CompactLayout::remap<uint64_t>(i - 1);
+        assert(j * sizeof(mpmc::CompactSlot<uint64_t>) /
+                   mpmc::hardwareInterferenceSize !=
+               prev * sizeof(mpmc::CompactSlot<uint64_t>) /
+                   mpmc::hardwareInterferenceSize);
+      }
+    }
+    assert(seen.size() == n);
+
+    CompactMPMCQueue<uint64_t> q(5);
+    // Slot array is rounded up to a whole block, plus the padding slot
+    assert(q.allocatedSize() == sizeof(mpmc::CompactSlot<uint64_t>) * (n + 1));
+    uint64_t v = 0;
+    for (uint64_t i = 0; i < 5; ++i) {
+      assert(q.try_push(i));
+    }
+    assert(!q.try_push(5));
+    for (uint64_t i = 0; i < 100; ++i) {
+      assert(q.try_pop(v) && v == i);
+      assert(q.try_push(i + 5));
     }
-    flag = true;
-    for (auto &thread : threads) {
-      thread.join();
+  }
+
+#ifdef __linux__
+  // Huge page allocator, falls back to regular pages if none are reserved
+  {
+    using Allocator = mpmc::HugePageAllocator<mpmc::Slot<TestType>>;
+    MPMCQueue<TestType, Allocator> q(11, Allocator(-1, true));
+    for (int i = 0; i < 10; i++) {
+      q.emplace();
     }
-    assert(sum == numOps * (numOps - 1) / 2);
+    assert(q.size() == 10);
+    TestType t;
+    q.pop(t);
+    assert(TestType::constructed.size() == 10);
   }
+  assert(TestType::constructed.size() == 0);
+
+  {
+    using Allocator = mpmc::HugePageAllocator<mpmc::CompactSlot<uint64_t>>;
+    CompactMPMCQueue<uint64_t, Allocator> q(1000, Allocator(0));
+    uint64_t v = 0;
+    assert(q.try_push(1) && q.try_pop(v) && v == 1);
+  }
+#endif
+
+  // Timed operations
+  {
+    using namespace std::chrono;
+    MPMCQueue<int> q(1);
+    int t = 0;
+    auto start = steady_clock::now();
+    assert(q.try_pop_for(t, milliseconds(10)) == false);
+    assert(steady_clock::now() - start >= milliseconds(10));
+    // A timed out pop must not leave a claimed ticket behind
+    assert(q.size() == 0 && q.empty());
+    assert(q.try_push_for(1, milliseconds(10)) == true);
+    start = steady_clock::now();
+    assert(q.try_push_until(2, steady_clock::now() + milliseconds(10)) ==
+           false);
+    assert(steady_clock::now() - start >= milliseconds(10));
+    assert(q.size() == 1);
+    assert(q.try_pop_until(t, steady_clock::now() + milliseconds(10)) ==
+               true &&
+           t == 1);
+    assert(q.try_push(3) && q.try_pop(t) && t == 3);
+    assert(q.size() == 0);
+
+    // Parked consumer is woken by a push
+    auto consumer = std::thread([&] {
+      int v = 0;
+      assert(q.try_pop_for(v, seconds(10)) && v == 4);
+    });
+    std::this_thread::sleep_for(milliseconds(10));
+    q.push(4);
+    consumer.join();
+
+    // Parked producer is woken by a pop
+    q.push(5);
+    auto producer = std::thread([&] { assert(q.try_push_for(6, seconds(10))); });
+    std::this_thread::sleep_for(milliseconds(10));
+    q.pop(t);
+    assert(t == 5);
+    producer.join();
+    q.pop(t);
+    assert(t == 6);
+  }
+
+  // Occupancy metrics and watermark callbacks
+  {
+    MPMCQueue<int> q(4);
+    size_t highs = 0, lows = 0, lastHigh = 0;
+    q.setWatermarkCallbacks(
+        3, [&](size_t n) { ++highs, lastHigh = n; }, 1,
+        [&](size_t) { ++lows; });
+    int t = 0;
+    assert(q.enqueued() == 0 && q.dequeued() == 0 && q.occupancy() == 0);
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 4; ++i) {
+        q.push(i);
+      }
+      assert(q.occupancy() == 4 && q.highWatermark() == 4);
+      // Fires once per crossing, not once per push above the mark
+      assert(highs == static_cast<size_t>(round + 1) && lastHigh == 3);
+      for (int i = 0; i < 4; ++i) {
+        q.pop(t);
+      }
+      assert(lows == static_cast<size_t>(round + 1));
+    }
+    assert(q.enqueued() == 12 && q.dequeued() == 12 && q.occupancy() == 0);
+    q.resetHighWatermark();
+    assert(q.highWatermark() == 0);
+    assert(q.try_pop(t) == false && q.dequeued() == 12);
+  }
+
+  // Fuzz test
+  fuzz<MPMCQueue<uint64_t>>();
+  fuzz<CompactMPMCQueue<uint64_t>>();
+  fuzzTimed<MPMCQueue<uint64_t>>();
 
   return 0;
 }
@@ -1,55 +1,153 @@
 #ifndef __THREAD_SAFE_MAP__
 #define __THREAD_SAFE_MAP__
 
-#include <map>
+#include <cstdint>
+#include <functional>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/noncopyable.h"
 
 namespace wzq {
-// thread safe map
-template <typename K, typename V>
-class ThreadSafeMap {
+/**
+ * thread safe map
+ * 按key的哈希分成多个分片，每个分片一把读写锁和一个unordered_map，不同分片上的操作互不影响
+ * 查找只加读锁，读多写少时多个线程可以同时查找同一个分片
+ * 每个分片独占缓存行，相邻分片的锁不会互相伪共享
+ * 不保证遍历顺序；Size和Snapshot逐个分片加锁，不是全局一致的结果
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ThreadSafeMap : NonCopyAble {
    public:
+    // shard_num: 分片个数，向上取整到2的幂
+    explicit ThreadSafeMap(size_t shard_num = 64) : shards_(RoundUpPowerOfTwo(shard_num)) {
+        shard_mask_ = shards_.size() - 1;
+    }
+
+    // key已经存在时覆盖
     void Emplace(const K& key, const V& v) {
-        std::unique_lock<std::mutex> lock(mutex_);
-        map_[key] = v;
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        shard.map_.insert_or_assign(key, v);
     }
 
     void Emplace(const K& key, V&& v) {
-        std::unique_lock<std::mutex> lock(mutex_);
-        map_[key] = std::move(v);
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        shard.map_.insert_or_assign(key, std::move(v));
+    }
+
+    // key不存在时才构造value，返回是否插入
+    template <typename... Args>
+    bool TryEmplace(const K& key, Args&&... args) {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        return shard.map_.try_emplace(key, std::forward<Args>(args)...).second;
+    }
+
+    bool EraseKey(const K& key) {
+        Shard& shard = GetShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        return shard.map_.erase(key) > 0;
+    }
+
+    // 删除pred(key, value)为true的元素，返回删除的个数；pred在分片的写锁内调用，不能再访问这个map
+    template <typename P>
+    size_t EraseIf(P&& pred) {
+        size_t erased = 0;
+        for (auto& shard : shards_) {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+            for (auto it = shard.map_.begin(); it != shard.map_.end();) {
+                if (pred(it->first, it->second)) {
+                    it = shard.map_.erase(it);
+                    ++erased;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return erased;
     }
 
-    void EraseKey(const K& key) {
-        std::unique_lock<std::mutex> lock(mutex_);
-        if (map_.find(key) != map_.end()) {
-            map_.erase(key);
+    std::optional<V> Find(const K& key) const {
+        const Shard& shard = GetShard(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+        auto it = shard.map_.find(key);
+        if (it == shard.map_.end()) {
+            return std::nullopt;
         }
+        return it->second;
     }
 
-    bool GetValueFromKey(const K& key, V& value) {
-        std::unique_lock<std::mutex> l(mutex_);
-        if (map_.find(key) != map_.end()) {
-            value = map_[key];
-            return true;
+    bool GetValueFromKey(const K& key, V& value) const {
+        const Shard& shard = GetShard(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+        auto it = shard.map_.find(key);
+        if (it == shard.map_.end()) {
+            return false;
         }
-        return false;
+        value = it->second;
+        return true;
     }
 
-    bool IsKeyExist(const K& key) {
-        std::unique_lock<std::mutex> l(mutex_);
-        return map_.find(key) != map_.end();
+    bool IsKeyExist(const K& key) const {
+        const Shard& shard = GetShard(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+        return shard.map_.find(key) != shard.map_.end();
     }
 
-    std::size_t Size() {
-        std::unique_lock<std::mutex> l(mutex_);
-        return map_.size();
+    std::size_t Size() const {
+        std::size_t size = 0;
+        for (auto& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+            size += shard.map_.size();
+        }
+        return size;
+    }
+
+    // 复制出所有元素用于遍历，遍历时不持有任何锁
+    std::vector<std::pair<K, V>> Snapshot() const {
+        std::vector<std::pair<K, V>> items;
+        for (auto& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+            items.insert(items.end(), shard.map_.begin(), shard.map_.end());
+        }
+        return items;
+    }
+
+   private:
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<K, V, Hash> map_;
+    };
+
+    static size_t RoundUpPowerOfTwo(size_t n) {
+        size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    Shard& GetShard(const K& key) { return shards_[ShardIndex(key)]; }
+
+    const Shard& GetShard(const K& key) const { return shards_[ShardIndex(key)]; }
+
+    // std::hash对整数是恒等映射，先打散再取高位，避免连续的key落到同一个分片
+    size_t ShardIndex(const K& key) const {
+        uint64_t hash = static_cast<uint64_t>(Hash()(key)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(hash >> 32) & shard_mask_;
     }
 
    private:
-    std::map<K, V> map_;
-    std::mutex mutex_;
+    std::vector<Shard> shards_;
+    size_t shard_mask_ = 0;
 };
 
 }  // namespace wzq
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/map.h"
+
+// 用法: map_bench
+// 1~32个线程，读多写少(90%查找)和写多读少(50%查找)两种操作比例下，
+// 分片的ThreadSafeMap与一把锁保护的std::map的每秒操作次数
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 之前的实现：一把std::mutex保护的std::map
+template <typename K, typename V>
+class LockedMap {
+   public:
+    void Emplace(const K& key, const V& v) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        map_[key] = v;
+    }
+
+    bool EraseKey(const K& key) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return map_.erase(key) > 0;
+    }
+
+    bool GetValueFromKey(const K& key, V& value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+   private:
+    std::map<K, V> map_;
+    std::mutex mutex_;
+};
+
+constexpr uint64_t kKeyNum = 1 << 16;
+constexpr size_t kOpsPerThread = 200000;
+
+template <typename Map>
+double Bench(Map& map, int thread_num, int read_percent) {
+    for (uint64_t key = 0; key < kKeyNum; key += 2) {
+        map.Emplace(key, key);
+    }
+
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> found{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937_64 random(t);
+            std::uniform_int_distribution<uint64_t> keys(0, kKeyNum - 1);
+            std::uniform_int_distribution<int> ops(0, 99);
+            uint64_t local_found = 0;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < kOpsPerThread; ++i) {
+                uint64_t key = keys(random);
+                int op = ops(random);
+                if (op < read_percent) {
+                    uint64_t value = 0;
+                    local_found += map.GetValueFromKey(key, value);
+                } else if (op % 2 == 0) {
+                    map.Emplace(key, key);
+                } else {
+                    map.EraseKey(key);
+                }
+            }
+            found += local_found;
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return thread_num * kOpsPerThread / seconds;
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "hardware threads " << std::thread::hardware_concurrency() << std::endl;
+    for (int read_percent : {90, 50}) {
+        for (int thread_num : {1, 2, 4, 8, 16, 32}) {
+            wzq::ThreadSafeMap<uint64_t, uint64_t> striped;
+            LockedMap<uint64_t, uint64_t> locked;
+            double striped_ops = Bench(striped, thread_num, read_percent);
+            double locked_ops = Bench(locked, thread_num, read_percent);
+            std::cout << read_percent << "% read, " << thread_num << " threads: ThreadSafeMap " << striped_ops / 1e6
+                      << " M ops/s, std::map + mutex " << locked_ops / 1e6 << " M ops/s" << std::endl;
+        }
+    }
+    return 0;
+}
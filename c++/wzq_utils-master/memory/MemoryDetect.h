@@ -10,3 +10,11 @@ void* operator new[](std::size_t size, const char* file, int line);
 #define new new (__FILE__, __LINE__)
 
 int checkLeaks();
+
+#ifdef _DEBUG_NEW_SAMPLE
+// 采样模式：按调用位置聚合的估计值，按还没释放的字节数从大到小输出前top个，返回调用位置个数
+int dumpAllocProfile(FILE* out = stdout, int top = 20);
+
+// 启动一个后台线程，每隔interval_ms调用一次dumpAllocProfile，只有第一次调用生效
+void startAllocProfileDump(unsigned interval_ms, FILE* out = stderr, int top = 20);
+#endif
@@ -0,0 +1,55 @@
+#ifndef __BARRIER__
+#define __BARRIER__
+
+#include "common/noncopyable.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace wzq {
+/**
+ * 可重复使用的屏障，count个线程都到达后一起进入下一个阶段
+ * completion不为空时，每个阶段由最后到达的线程在放行其他线程之前调用
+ * 默认所有线程在同一个计数器上到达；fan_in大于0且小于count时使用合并树，
+ * 每fan_in个线程共用一个叶子计数器，叶子上最后到达的线程再到上一层到达，线程很多时减少对同一个缓存行的争用
+ * 等待的线程先自旋一会儿再睡眠，放行时只有有线程睡眠才需要系统调用
+ */
+class Barrier : NonCopyAble {
+   public:
+    explicit Barrier(uint32_t count, std::function<void()> completion = nullptr);
+
+    Barrier(uint32_t count, uint32_t fan_in, std::function<void()> completion = nullptr);
+
+    /**
+     * 到达并等待本阶段的所有线程到达，完成本阶段的线程返回true
+     * index: 合并树模式下每个线程在[0, count)中的编号，同一个阶段中不能重复；默认模式下忽略
+     */
+    bool ArriveAndWait(uint32_t index = 0);
+
+    uint32_t GetCount() const { return count_; }
+
+   private:
+    struct alignas(64) Node {
+        std::atomic<uint32_t> arrived{0};
+        uint32_t expected = 0;
+        int parent = -1;
+    };
+
+    void Wait(uint32_t phase);
+
+    void Release(uint32_t phase);
+
+   private:
+    const uint32_t count_;
+    uint32_t fan_in_;
+    std::function<void()> completion_;
+    // 第一层是叶子，最后一个是根
+    std::vector<Node> nodes_;
+    // 最低位表示有线程睡眠，其余位是阶段编号
+    alignas(64) std::atomic<uint32_t> phase_{0};
+};
+}  // namespace wzq
+
+#endif
@@ -3,26 +3,30 @@
 
 #include "common/noncopyable.h"
 
-#include <condition_variable>
-#include <iostream>
-#include <mutex>
+#include <atomic>
+#include <cstdint>
 
 namespace wzq {
+/**
+ * 计数只是一个原子变量，CountDown不加锁，只有减到0的那一次才唤醒等待的线程
+ * 等待的线程先自旋一会儿，计数还没有到0再睡眠
+ * 计数减到0后CountDown不再访问对象，Await返回后可以立即销毁
+ */
 class CountDownLatch : NonCopyAble {
    public:
     explicit CountDownLatch(uint32_t count);
 
     void CountDown();
 
+    // 等待计数减到0；time_ms大于0时每隔time_ms醒来检查一次
     void Await(uint32_t time_ms = 0);
 
     uint32_t GetCount() const;
 
    private:
-    std::condition_variable cv_;
-    mutable std::mutex mutex_;
-    uint32_t count_ = 0;
+    // 低31位是计数，最高位表示有线程睡眠，没有线程睡眠时减到0也不需要系统调用
+    std::atomic<uint32_t> count_;
 };
 }  // namespace wzq
 
-#endif
\ No newline at end of file
+#endif
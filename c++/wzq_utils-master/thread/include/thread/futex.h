@@ -0,0 +1,34 @@
+#ifndef __FUTEX__
+#define __FUTEX__
+
+#include <atomic>
+#include <cstdint>
+
+namespace wzq {
+
+/**
+ * 在32位原子变量上等待和唤醒，C++17没有atomic::wait，这里补上
+ * linux上直接使用futex系统调用，其他平台按地址哈希到一组互斥锁和条件变量上
+ * FutexWait在值不等于expected时立即返回，也可能无故返回，调用者需要在循环中重新检查
+ */
+
+// time_ms为0时一直等待
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t time_ms = 0);
+
+void FutexWakeAll(std::atomic<uint32_t>* word);
+
+// 睡眠之前自旋的次数，只有一个CPU时自旋只会占用释放者需要的时间片，返回0
+int SpinCount(int spin_count);
+
+// 自旋等待时降低功耗，让出流水线给同一物理核上的另一个线程
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}  // namespace wzq
+
+#endif
@@ -1,12 +1,12 @@
 #ifndef __THREAD_POOL__
 #define __THREAD_POOL__
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <future>
-#include <iostream>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -16,14 +16,19 @@
 #include <utility>
 #include <vector>
 
-using std::cout;
-using std::endl;
-
 namespace wzq {
 
+/**
+ * 线程池
+ * 默认不输出任何日志；定义WZQ_THREAD_POOL_TRACE编译时，线程的创建、等待、唤醒、退出等事件会回调SetTraceHook设置的函数
+ * WZQ_THREAD_POOL_TRACE必须在整个程序的所有编译单元中保持一致，否则ThreadPool在不同编译单元中的定义不同（违反ODR）
+ * 任务积压时按积压的任务数和队首任务的等待时间创建Cache线程，空闲的Cache线程按cool_down的间隔逐个退出
+ * 关闭时等待所有线程退出，析构后不会再有线程访问线程池；不能在线程池的任务中析构线程池
+ */
 class ThreadPool {
    public:
     using PoolSeconds = std::chrono::seconds;
+    using PoolMilliseconds = std::chrono::milliseconds;
 
     /** 线程池的配置
      * core_threads: 核心线程个数，线程池中最少拥有的线程个数，初始化就会创建好的线程，常驻于线程池
@@ -31,16 +36,26 @@ class ThreadPool {
      * max_threads: >=core_threads，当任务的个数太多线程池执行不过来时，
      * 内部就会创建更多的线程用于执行更多的任务，内部线程数不会超过max_threads
      *
-     * max_task_size: 内部允许存储的最大任务个数，暂时没有使用
+     * max_task_size: 内部允许存储的最大任务个数，队列满时Run/Execute阻塞直到有空位，<=0表示不限制
+     * 注意不要在线程池的任务中向已满的同一个线程池提交任务，所有线程都这样做时会死锁
      *
      * time_out: Cache线程的超时时间，Cache线程指的是max_threads-core_threads的线程,
      * 当time_out时间内没有执行任务，此线程就会被自动回收
+     *
+     * grow_queue_depth: 积压的任务数(队列中的任务数减去等待中的线程数)达到这个值时创建Cache线程
+     *
+     * grow_wait_time: 队首任务等待超过这个时间时也创建Cache线程，0表示不按等待时间创建
+     *
+     * cool_down: 两个Cache线程退出的最小间隔，避免突发任务过后线程一起退出、下一次突发又一起创建，0表示不限制
      */
     struct ThreadPoolConfig {
         int core_threads;
         int max_threads;
         int max_task_size;
         PoolSeconds time_out;
+        int grow_queue_depth = 1;
+        PoolMilliseconds grow_wait_time{0};
+        PoolMilliseconds cool_down{0};
     };
 
     /**
@@ -53,25 +68,37 @@ class ThreadPool {
      */
     enum class ThreadFlag { kInit = 0, kCore = 1, kCache = 2 };
 
+    /**
+     * 跟踪事件，thread_id为-1表示线程池本身的事件
+     * kThreadWait/kThreadWake只在线程没有任务可执行、需要等待时产生
+     */
+    enum class TraceEvent {
+        kStart = 0,
+        kShutDown = 1,
+        kShutDownNow = 2,
+        kResize = 3,
+        kAddThread = 4,
+        kThreadWait = 5,
+        kThreadWake = 6,
+        kThreadExit = 7
+    };
+
+    // 可能在多个线程中同时调用；工作线程的事件在持有任务锁时调用，不能再调用线程池的接口
+    using TraceHook = std::function<void(TraceEvent event, int thread_id)>;
+
     using ThreadPtr = std::shared_ptr<std::thread>;
-    using ThreadId = std::atomic<int>;
     using ThreadStateAtomic = std::atomic<ThreadState>;
-    using ThreadFlagAtomic = std::atomic<ThreadFlag>;
 
     /**
      * 线程池中线程存在的基本单位，每个线程都有个自定义的ID，有线程种类标识和状态
+     * id在线程启动前确定，之后不再改变；ptr、flag和state只在持有任务锁时修改，Resize会改变flag
+     * 每个线程的状态独占缓存行，线程修改自己的状态不会影响其他线程
      */
-    struct ThreadWrapper {
+    struct alignas(64) ThreadWrapper {
         ThreadPtr ptr;
-        ThreadId id;
-        ThreadFlagAtomic flag;
-        ThreadStateAtomic state;
-
-        ThreadWrapper() {
-            ptr = nullptr;
-            id = 0;
-            state.store(ThreadState::kInit);
-        }
+        int id = 0;
+        ThreadFlag flag = ThreadFlag::kInit;
+        ThreadStateAtomic state{ThreadState::kInit};
     };
     using ThreadWrapperPtr = std::shared_ptr<ThreadWrapper>;
     using ThreadPoolLock = std::unique_lock<std::mutex>;
@@ -93,14 +120,18 @@ class ThreadPool {
 
     ~ThreadPool() { ShutDown(); }
 
+    // 修改线程数以外的配置，修改核心线程数使用Resize
     bool Reset(ThreadPoolConfig config) {
         if (!IsValidConfig(config)) {
             return false;
         }
+        ThreadPoolLock lock(this->task_mutex_);
         if (config_.core_threads != config.core_threads) {
             return false;
         }
         config_ = config;
+        // 队列变大时让阻塞的提交线程重新检查
+        this->not_full_cv_.notify_all();
         return true;
     }
 
@@ -109,12 +140,49 @@ class ThreadPool {
         if (!IsAvailable()) {
             return false;
         }
-        int core_thread_num = config_.core_threads;
-        cout << "Init thread num " << core_thread_num << endl;
-        while (core_thread_num-- > 0) {
-            AddThread(GetNextThreadId());
+        Trace(TraceEvent::kStart, -1);
+        ThreadPoolLock lock(this->task_mutex_);
+        for (int i = 0; i < config_.core_threads; ++i) {
+            NewThreadLocked(ThreadFlag::kCore);
+        }
+        return true;
+    }
+
+    /**
+     * 修改核心线程数，可以在多个线程中同时调用；max_threads小于thread_num时一起调大
+     * 增加时先把Cache线程转为核心线程，不够再创建；减少时多出来的核心线程转为Cache线程，空闲后按cool_down逐个退出
+     */
+    bool Resize(int thread_num) {
+        if (thread_num < 1) {
+            return false;
+        }
+        {
+            ThreadPoolLock lock(this->task_mutex_);
+            if (!IsAvailable()) {
+                return false;
+            }
+            config_.core_threads = thread_num;
+            config_.max_threads = std::max(config_.max_threads, thread_num);
+            int core_num = 0;
+            for (auto &thread : worker_threads_) {
+                core_num += thread->flag == ThreadFlag::kCore;
+            }
+            for (auto &thread : worker_threads_) {
+                if (core_num < thread_num && thread->flag == ThreadFlag::kCache) {
+                    thread->flag = ThreadFlag::kCore;
+                    ++core_num;
+                } else if (core_num > thread_num && thread->flag == ThreadFlag::kCore) {
+                    thread->flag = ThreadFlag::kCache;
+                    --core_num;
+                }
+            }
+            for (; core_num < thread_num; ++core_num) {
+                NewThreadLocked(ThreadFlag::kCore);
+            }
         }
-        cout << "Init thread end" << endl;
+        // 转为Cache线程的线程重新开始计算空闲时间
+        this->task_cv_.notify_all();
+        Trace(TraceEvent::kResize, -1);
         return true;
     }
 
@@ -122,7 +190,7 @@ class ThreadPool {
     int GetWaitingThreadSize() { return this->waiting_thread_num_.load(); }
 
     // 获取线程池中当前线程的总个数
-    int GetTotalThreadSize() { return this->worker_threads_.size(); }
+    int GetTotalThreadSize() { return this->thread_num_.load(); }
 
     // 放在线程池中执行函数
     template <typename F, typename... Args>
@@ -130,147 +198,316 @@ class ThreadPool {
         if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
             return nullptr;
         }
-        if (GetWaitingThreadSize() == 0 && GetTotalThreadSize() < config_.max_threads) {
-            AddThread(GetNextThreadId(), ThreadFlag::kCache);
-        }
 
         using return_type = std::result_of_t<F(Args...)>;
         auto task = std::make_shared<std::packaged_task<return_type()>>(
             std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-        total_function_num_++;
-
         std::future<return_type> res = task->get_future();
+        if (!Push([task]() { (*task)(); })) {
+            return nullptr;
+        }
+        return std::make_shared<std::future<std::result_of_t<F(Args...)>>>(std::move(res));
+    }
+
+    // 放在线程池中执行函数，不关心结果时使用，省去了packaged_task和future的分配；线程池不可用时返回false
+    template <typename F, typename... Args>
+    bool Execute(F &&f, Args &&... args) {
+        if constexpr (sizeof...(Args) == 0) {
+            return Push(std::function<void()>(std::forward<F>(f)));
+        } else {
+            return Push(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        }
+    }
+
+    // 批量放入线程池执行，只加一次锁、唤醒一次，不返回future；成功后tasks被清空
+    // 队列有上限时分多次放入，中途线程池关闭返回false，tasks中剩下的是没有放入的任务
+    bool RunBatch(std::vector<std::function<void()>> &tasks) {
+        if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
+            return false;
+        }
+        if (tasks.empty()) {
+            return true;
+        }
+
+        size_t pushed = 0;
         {
             ThreadPoolLock lock(this->task_mutex_);
-            this->tasks_.emplace([task]() { (*task)(); });
+            while (pushed < tasks.size()) {
+                if (pushed > 0) {
+                    // 先让线程执行已经放入的任务，再等待空位
+                    this->task_cv_.notify_all();
+                }
+                if (!WaitForSpace(lock)) {
+                    break;
+                }
+                auto enqueue_time = EnqueueTime();
+                while (pushed < tasks.size() && !IsFull()) {
+                    this->tasks_.push(PendingTask{std::move(tasks[pushed++]), enqueue_time});
+                }
+            }
+            total_function_num_ += pushed;
+            GrowLocked();
         }
-        this->task_cv_.notify_one();
-        return std::make_shared<std::future<std::result_of_t<F(Args...)>>>(std::move(res));
+        if (pushed == 1) {
+            this->task_cv_.notify_one();
+        } else {
+            this->task_cv_.notify_all();
+        }
+        tasks.erase(tasks.begin(), tasks.begin() + pushed);
+        return tasks.empty();
     }
 
     // 获取当前线程池已经执行过的函数个数
     int GetRunnedFuncNum() { return total_function_num_.load(); }
 
-    // 关掉线程池，内部还没有执行的任务会继续执行
+    // 关掉线程池，内部还没有执行的任务会继续执行，执行完后返回
     void ShutDown() {
         ShutDown(false);
-        cout << "shutdown" << endl;
+        Trace(TraceEvent::kShutDown, -1);
+        JoinAll();
     }
 
-    // 执行关掉线程池，内部还没有执行的任务直接取消，不会再执行
+    // 执行关掉线程池，内部还没有执行的任务直接取消，不会再执行；等正在执行的任务执行完后返回
     void ShutDownNow() {
         ShutDown(true);
-        cout << "shutdown now" << endl;
+        Trace(TraceEvent::kShutDownNow, -1);
+        JoinAll();
+    }
+
+    /**
+     * 关掉线程池，最多等待timeout让内部还没有执行的任务继续执行，超时后剩下的任务直接取消
+     * 等正在执行的任务执行完后返回，所有任务都执行了返回true
+     * 任务本身不会被打断，返回的时间取决于timeout和单个任务的执行时间
+     */
+    template <typename R, typename P>
+    bool ShutDownFor(const std::chrono::duration<R, P> &timeout) {
+        auto deadline = Clock::now() + timeout;
+        ShutDown(false);
+        Trace(TraceEvent::kShutDown, -1);
+        std::queue<PendingTask> canceled;
+        {
+            ThreadPoolLock lock(this->task_mutex_);
+            if (!this->drained_cv_.wait_until(lock, deadline, [this] { return this->tasks_.empty(); })) {
+                this->is_shutdown_now_.store(true);
+                canceled.swap(this->tasks_);
+            }
+        }
+        if (!canceled.empty()) {
+            this->task_cv_.notify_all();
+            Trace(TraceEvent::kShutDownNow, -1);
+        }
+        JoinAll();
+        return canceled.empty();
     }
 
     // 当前线程池是否可用
     bool IsAvailable() { return is_available_.load(); }
 
+    // 只在定义WZQ_THREAD_POOL_TRACE编译时生效，需要在Start之前设置
+    void SetTraceHook(TraceHook hook) { trace_hook_ = std::move(hook); }
+
    private:
-    void ShutDown(bool is_now) {
-        if (is_available_.load()) {
-            if (is_now) {
-                this->is_shutdown_now_.store(true);
-            } else {
-                this->is_shutdown_.store(true);
+    using Clock = std::chrono::steady_clock;
+
+    // 只有配置了grow_wait_time时才记录入队时间
+    struct PendingTask {
+        std::function<void()> func;
+        Clock::time_point enqueue_time;
+    };
+
+    void Trace(TraceEvent event, int thread_id) {
+#ifdef WZQ_THREAD_POOL_TRACE
+        if (trace_hook_) {
+            trace_hook_(event, thread_id);
+        }
+#else
+        (void)event;
+        (void)thread_id;
+#endif
+    }
+
+    bool Push(std::function<void()> &&task) {
+        if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
+            return false;
+        }
+
+        {
+            ThreadPoolLock lock(this->task_mutex_);
+            if (!WaitForSpace(lock)) {
+                return false;
             }
-            this->task_cv_.notify_all();
-            is_available_.store(false);
+            this->tasks_.push(PendingTask{std::move(task), EnqueueTime()});
+            total_function_num_++;
+            GrowLocked();
+        }
+        this->task_cv_.notify_one();
+        return true;
+    }
+
+    Clock::time_point EnqueueTime() {
+        return config_.grow_wait_time.count() > 0 ? Clock::now() : Clock::time_point();
+    }
+
+    bool IsFull() { return config_.max_task_size > 0 && this->tasks_.size() >= size_t(config_.max_task_size); }
+
+    // 需要持有任务锁，队列满时阻塞，线程池关闭时返回false
+    bool WaitForSpace(ThreadPoolLock &lock) {
+        while (IsFull() && !this->is_shutdown_ && !this->is_shutdown_now_) {
+            ++this->blocked_push_num_;
+            this->not_full_cv_.wait(lock);
+            --this->blocked_push_num_;
         }
+        return !this->is_shutdown_ && !this->is_shutdown_now_;
     }
 
-    void AddThread(int id) { AddThread(id, ThreadFlag::kCore); }
+    // 需要持有任务锁，积压的任务足够多或者队首任务等待太久时创建一个Cache线程
+    void GrowLocked() {
+        if (GetTotalThreadSize() >= config_.max_threads || this->is_shutdown_ || this->is_shutdown_now_) {
+            return;
+        }
+        size_t waiting = this->waiting_thread_num_.load();
+        if (this->tasks_.size() <= waiting) {
+            return;
+        }
+        size_t backlog = this->tasks_.size() - waiting;
+        bool too_deep = backlog >= size_t(config_.grow_queue_depth);
+        bool too_late = config_.grow_wait_time.count() > 0 &&
+                        Clock::now() - this->tasks_.front().enqueue_time >= config_.grow_wait_time;
+        if (!too_deep && !too_late) {
+            return;
+        }
+        NewThreadLocked(ThreadFlag::kCache);
+    }
 
-    void AddThread(int id, ThreadFlag thread_flag) {
-        cout << "AddThread " << id << " flag " << static_cast<int>(thread_flag) << endl;
+    // 需要持有任务锁，在锁内登记并启动线程，关闭线程池时不会漏掉正在创建的线程
+    void NewThreadLocked(ThreadFlag thread_flag) {
+        JoinRetiredLocked();
         ThreadWrapperPtr thread_ptr = std::make_shared<ThreadWrapper>();
-        thread_ptr->id.store(id);
-        thread_ptr->flag.store(thread_flag);
-        auto func = [this, thread_ptr]() {
+        thread_ptr->id = GetNextThreadId();
+        thread_ptr->flag = thread_flag;
+        Trace(TraceEvent::kAddThread, thread_ptr->id);
+        ThreadWrapper *self = thread_ptr.get();
+        thread_ptr->ptr = std::make_shared<std::thread>([this, self]() {
             for (;;) {
                 std::function<void()> task;
                 {
                     ThreadPoolLock lock(this->task_mutex_);
-                    if (thread_ptr->state.load() == ThreadState::kStop) {
-                        break;
-                    }
-                    cout << "thread id " << thread_ptr->id.load() << " running start" << endl;
-                    thread_ptr->state.store(ThreadState::kWaiting);
-                    ++this->waiting_thread_num_;
-                    bool is_timeout = false;
-                    if (thread_ptr->flag.load() == ThreadFlag::kCore) {
-                        this->task_cv_.wait(lock, [this, thread_ptr] {
-                            return (this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                    thread_ptr->state.load() == ThreadState::kStop);
-                        });
-                    } else {
-                        this->task_cv_.wait_for(lock, this->config_.time_out, [this, thread_ptr] {
-                            return (this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                    thread_ptr->state.load() == ThreadState::kStop);
-                        });
-                        is_timeout = !(this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                       thread_ptr->state.load() == ThreadState::kStop);
-                    }
-                    --this->waiting_thread_num_;
-                    cout << "thread id " << thread_ptr->id.load() << " running wait end" << endl;
-
-                    if (is_timeout) {
-                        thread_ptr->state.store(ThreadState::kStop);
-                    }
-
-                    if (thread_ptr->state.load() == ThreadState::kStop) {
-                        cout << "thread id " << thread_ptr->id.load() << " state stop" << endl;
+                    if (!WaitForTask(*self, lock)) {
                         break;
                     }
-                    if (this->is_shutdown_ && this->tasks_.empty()) {
-                        cout << "thread id " << thread_ptr->id.load() << " shutdown" << endl;
-                        break;
+                    task = std::move(this->tasks_.front().func);
+                    this->tasks_.pop();
+                    if (this->blocked_push_num_ > 0) {
+                        this->not_full_cv_.notify_one();
                     }
-                    if (this->is_shutdown_now_) {
-                        cout << "thread id " << thread_ptr->id.load() << " shutdown now" << endl;
-                        break;
+                    if (this->tasks_.empty() && this->is_shutdown_) {
+                        this->drained_cv_.notify_all();
                     }
-                    thread_ptr->state.store(ThreadState::kRunning);
-                    task = std::move(this->tasks_.front());
-                    this->tasks_.pop();
+                    // 剩下的任务还在积压时继续扩容，不必等到下一次提交
+                    GrowLocked();
                 }
                 task();
             }
-            cout << "thread id " << thread_ptr->id.load() << " running end" << endl;
-        };
-        thread_ptr->ptr = std::make_shared<std::thread>(std::move(func));
-        if (thread_ptr->ptr->joinable()) {
-            thread_ptr->ptr->detach();
+            Trace(TraceEvent::kThreadExit, self->id);
+        });
+        this->worker_threads_.push_back(std::move(thread_ptr));
+        ++this->thread_num_;
+    }
+
+    // 需要持有任务锁；退出的线程已经释放了锁，join很快返回
+    void JoinRetiredLocked() {
+        for (auto &thread : this->retired_threads_) {
+            thread->ptr->join();
         }
-        this->worker_threads_.emplace_back(std::move(thread_ptr));
+        this->retired_threads_.clear();
     }
 
-    void Resize(int thread_num) {
-        if (thread_num < config_.core_threads) return;
-        int old_thread_num = worker_threads_.size();
-        cout << "old num " << old_thread_num << " resize " << thread_num << endl;
-        if (thread_num > old_thread_num) {
-            while (thread_num-- > old_thread_num) {
-                AddThread(GetNextThreadId());
+    // 等待所有线程退出；在线程池自己的线程中调用时不能等待自己，只能分离
+    void JoinAll() {
+        std::list<ThreadWrapperPtr> threads;
+        {
+            ThreadPoolLock lock(this->task_mutex_);
+            threads.swap(this->worker_threads_);
+            threads.splice(threads.end(), this->retired_threads_);
+        }
+        for (auto &thread : threads) {
+            if (thread->ptr->get_id() == std::this_thread::get_id()) {
+                thread->ptr->detach();
+            } else if (thread->ptr->joinable()) {
+                thread->ptr->join();
             }
-        } else {
-            int diff = old_thread_num - thread_num;
-            auto iter = worker_threads_.begin();
-            while (iter != worker_threads_.end()) {
-                if (diff == 0) {
-                    break;
+        }
+    }
+
+    // 需要持有任务锁，有任务可执行时返回true；队列中有任务时不进入等待，也不修改等待线程数
+    bool WaitForTask(ThreadWrapper &self, ThreadPoolLock &lock) {
+        auto wait_time = Clock::duration(this->config_.time_out);
+        for (;;) {
+            if (this->is_shutdown_now_) {
+                return false;
+            }
+            if (!this->tasks_.empty()) {
+                self.state.store(ThreadState::kRunning, std::memory_order_relaxed);
+                return true;
+            }
+            if (this->is_shutdown_) {
+                return false;
+            }
+
+            self.state.store(ThreadState::kWaiting, std::memory_order_relaxed);
+            ++this->waiting_thread_num_;
+            Trace(TraceEvent::kThreadWait, self.id);
+            bool is_timeout = false;
+            if (self.flag == ThreadFlag::kCore) {
+                this->task_cv_.wait(lock);
+            } else {
+                is_timeout = this->task_cv_.wait_for(lock, wait_time) == std::cv_status::timeout;
+            }
+            --this->waiting_thread_num_;
+            Trace(TraceEvent::kThreadWake, self.id);
+
+            wait_time = Clock::duration(this->config_.time_out);
+            if (is_timeout && self.flag == ThreadFlag::kCache && this->tasks_.empty() && !this->is_shutdown_) {
+                auto retire_time = this->last_retire_time_ + this->config_.cool_down;
+                auto now = Clock::now();
+                if (now >= retire_time) {
+                    Retire(self, now);
+                    return false;
                 }
-                auto thread_ptr = *iter;
-                if (thread_ptr->flag.load() == ThreadFlag::kCache &&
-                    thread_ptr->state.load() == ThreadState::kWaiting) {  // wait
-                    thread_ptr->state.store(ThreadState::kStop);          // stop;
-                    --diff;
-                    iter = worker_threads_.erase(iter);
+                // 刚有线程退出，冷却结束后再试
+                wait_time = retire_time - now;
+            }
+        }
+    }
+
+    // 需要持有任务锁，退出的线程交给下一个退出或者创建的线程join
+    void Retire(ThreadWrapper &self, Clock::time_point now) {
+        self.state.store(ThreadState::kStop, std::memory_order_relaxed);
+        this->last_retire_time_ = now;
+        JoinRetiredLocked();
+        for (auto it = this->worker_threads_.begin(); it != this->worker_threads_.end(); ++it) {
+            if (it->get() == &self) {
+                this->retired_threads_.splice(this->retired_threads_.end(), this->worker_threads_, it);
+                break;
+            }
+        }
+        --this->thread_num_;
+    }
+
+    void ShutDown(bool is_now) {
+        if (is_available_.load()) {
+            {
+                ThreadPoolLock lock(this->task_mutex_);
+                if (is_now) {
+                    this->is_shutdown_now_.store(true);
                 } else {
-                    ++iter;
+                    this->is_shutdown_.store(true);
                 }
+                is_available_.store(false);
             }
             this->task_cv_.notify_all();
+            this->not_full_cv_.notify_all();
+            this->drained_cv_.notify_all();
         }
     }
 
@@ -280,27 +517,41 @@ class ThreadPool {
         if (config.core_threads < 1 || config.max_threads < config.core_threads || config.time_out.count() < 1) {
             return false;
         }
+        if (config.grow_queue_depth < 1 || config.grow_wait_time.count() < 0 || config.cool_down.count() < 0) {
+            return false;
+        }
         return true;
     }
 
    private:
+    // 以下由task_mutex_保护
     ThreadPoolConfig config_;
 
     std::list<ThreadWrapperPtr> worker_threads_;
+    // 已经退出还没有join的线程
+    std::list<ThreadWrapperPtr> retired_threads_;
+
+    std::queue<PendingTask> tasks_;
+    int blocked_push_num_ = 0;
+    Clock::time_point last_retire_time_;
 
-    std::queue<std::function<void()>> tasks_;
     std::mutex task_mutex_;
     std::condition_variable task_cv_;
+    std::condition_variable not_full_cv_;
+    std::condition_variable drained_cv_;
 
     std::atomic<int> total_function_num_;
     std::atomic<int> waiting_thread_num_;
     std::atomic<int> thread_id_;
+    std::atomic<int> thread_num_{0};
 
     std::atomic<bool> is_shutdown_now_;
     std::atomic<bool> is_shutdown_;
     std::atomic<bool> is_available_;
+
+    TraceHook trace_hook_;
 };
 
 }  // namespace wzq
 
-#endif
\ No newline at end of file
+#endif
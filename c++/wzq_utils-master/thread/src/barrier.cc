@@ -0,0 +1,90 @@
+#include "thread/barrier.h"
+
+#include "thread/futex.h"
+
+namespace wzq {
+
+namespace {
+constexpr uint32_t kWaiterBit = 1;
+constexpr uint32_t kPhaseStep = 2;
+constexpr int kSpinCount = 200;
+}  // namespace
+
+Barrier::Barrier(uint32_t count, std::function<void()> completion) : Barrier(count, 0, std::move(completion)) {}
+
+Barrier::Barrier(uint32_t count, uint32_t fan_in, std::function<void()> completion)
+    : count_(count > 0 ? count : 1), fan_in_(fan_in), completion_(std::move(completion)) {
+    if (fan_in_ < 2 || fan_in_ >= count_) {
+        fan_in_ = count_;
+    }
+    // 逐层建树：每层的节点个数是下一层的1/fan_in，直到只剩根
+    std::vector<uint32_t> level_expected;
+    for (uint32_t children = count_;;) {
+        uint32_t node_num = (children + fan_in_ - 1) / fan_in_;
+        for (uint32_t i = 0; i < node_num; ++i) {
+            level_expected.push_back(i + 1 < node_num ? fan_in_ : children - i * fan_in_);
+        }
+        if (node_num == 1) {
+            break;
+        }
+        children = node_num;
+    }
+    nodes_ = std::vector<Node>(level_expected.size());
+    size_t level_begin = 0;
+    size_t level_size = (count_ + fan_in_ - 1) / fan_in_;
+    while (level_begin + level_size < nodes_.size()) {
+        size_t next_begin = level_begin + level_size;
+        for (size_t i = 0; i < level_size; ++i) {
+            nodes_[level_begin + i].parent = static_cast<int>(next_begin + i / fan_in_);
+        }
+        level_begin = next_begin;
+        level_size = (level_size + fan_in_ - 1) / fan_in_;
+    }
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        nodes_[i].expected = level_expected[i];
+    }
+}
+
+bool Barrier::ArriveAndWait(uint32_t index) {
+    // 必须在到达之前读取阶段，到达之后阶段随时可能前进
+    uint32_t phase = phase_.load(std::memory_order_acquire) & ~kWaiterBit;
+    int node = static_cast<int>((index % count_) / fan_in_);
+    while (node >= 0) {
+        Node& current = nodes_[node];
+        if (current.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 != current.expected) {
+            Wait(phase);
+            return false;
+        }
+        // 这个节点本阶段不会再有线程到达，重置后留给下一阶段；放行时的release保证下一阶段看到重置
+        current.arrived.store(0, std::memory_order_relaxed);
+        node = current.parent;
+    }
+    if (completion_) {
+        completion_();
+    }
+    Release(phase);
+    return true;
+}
+
+void Barrier::Wait(uint32_t phase) {
+    for (int i = 0, spin = SpinCount(kSpinCount); i < spin; ++i) {
+        if ((phase_.load(std::memory_order_acquire) & ~kWaiterBit) != phase) {
+            return;
+        }
+        CpuRelax();
+    }
+    uint32_t value = phase_.fetch_or(kWaiterBit, std::memory_order_acq_rel) | kWaiterBit;
+    while ((value & ~kWaiterBit) == phase) {
+        FutexWait(&phase_, value);
+        value = phase_.load(std::memory_order_acquire);
+    }
+}
+
+void Barrier::Release(uint32_t phase) {
+    uint32_t old = phase_.exchange(phase + kPhaseStep, std::memory_order_acq_rel);
+    if (old & kWaiterBit) {
+        FutexWakeAll(&phase_);
+    }
+}
+
+}  // namespace wzq
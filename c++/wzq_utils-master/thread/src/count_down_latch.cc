@@ -1,33 +1,39 @@
 #include "thread/count_down_latch.h"
-#include <thread>
-#include <chrono>
+
+#include "thread/futex.h"
 
 namespace wzq {
 
-CountDownLatch::CountDownLatch(uint32_t count) : count_(count) {}
+namespace {
+constexpr uint32_t kWaiterBit = 1u << 31;
+constexpr uint32_t kCountMask = kWaiterBit - 1;
+constexpr int kSpinCount = 200;
+}  // namespace
 
-void CountDownLatch::CountDown() { 
-  std::unique_lock<std::mutex> lock(mutex_);
-  --count_;
-  if (count_ == 0) {
-    cv_.notify_all();
-  }
-}
+CountDownLatch::CountDownLatch(uint32_t count) : count_(count & kCountMask) {}
 
-void CountDownLatch::Await(uint32_t time_ms) { 
-   std::unique_lock<std::mutex> lock(mutex_);
-   while (count_ > 0) {
-     if (time_ms > 0) {
-       cv_.wait_for(lock, std::chrono::milliseconds(time_ms));
-     } else {
-       cv_.wait(lock);
-     }
-   }
+void CountDownLatch::CountDown() {
+    // 计数和睡眠标志在同一个原子变量中，减完之后不再读取对象的成员
+    uint32_t old = count_.fetch_sub(1, std::memory_order_acq_rel);
+    if ((old & kCountMask) == 1 && (old & kWaiterBit)) {
+        FutexWakeAll(&count_);
+    }
 }
 
-uint32_t CountDownLatch::GetCount() const{ 
-  std::unique_lock<std::mutex> lock(mutex_);
-  return count_; 
+void CountDownLatch::Await(uint32_t time_ms) {
+    for (int i = 0, spin = SpinCount(kSpinCount); i < spin; ++i) {
+        if ((count_.load(std::memory_order_acquire) & kCountMask) == 0) {
+            return;
+        }
+        CpuRelax();
+    }
+    uint32_t count = count_.fetch_or(kWaiterBit, std::memory_order_acq_rel) | kWaiterBit;
+    while ((count & kCountMask) != 0) {
+        FutexWait(&count_, count, time_ms);
+        count = count_.load(std::memory_order_acquire);
+    }
 }
 
-}  // namespace wzq
\ No newline at end of file
+uint32_t CountDownLatch::GetCount() const { return count_.load() & kCountMask; }
+
+}  // namespace wzq
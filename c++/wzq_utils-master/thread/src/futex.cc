@@ -0,0 +1,80 @@
+#include "thread/futex.h"
+
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <climits>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace wzq {
+
+#ifdef __linux__
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t time_ms) {
+    timespec timeout{};
+    timespec* timeout_ptr = nullptr;
+    if (time_ms > 0) {
+        timeout.tv_sec = time_ms / 1000;
+        timeout.tv_nsec = (time_ms % 1000) * 1000000L;
+        timeout_ptr = &timeout;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, timeout_ptr, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+namespace {
+
+struct alignas(64) ParkingBucket {
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+ParkingBucket& GetBucket(const void* address) {
+    static ParkingBucket buckets[64];
+    return buckets[(reinterpret_cast<uintptr_t>(address) >> 4) % 64];
+}
+
+}  // namespace
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t time_ms) {
+    ParkingBucket& bucket = GetBucket(word);
+    std::unique_lock<std::mutex> lock(bucket.mutex_);
+    if (word->load() != expected) {
+        return;
+    }
+    if (time_ms > 0) {
+        bucket.cv_.wait_for(lock, std::chrono::milliseconds(time_ms));
+    } else {
+        bucket.cv_.wait(lock);
+    }
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* word) {
+    ParkingBucket& bucket = GetBucket(word);
+    // 加锁保证等待者要么还没检查值，要么已经在等待
+    std::unique_lock<std::mutex> lock(bucket.mutex_);
+    bucket.cv_.notify_all();
+}
+
+#endif
+
+int SpinCount(int spin_count) {
+    static const bool single_cpu = std::thread::hardware_concurrency() == 1;
+    return single_cpu ? 0 : spin_count;
+}
+
+}  // namespace wzq
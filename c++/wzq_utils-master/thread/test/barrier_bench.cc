@@ -0,0 +1,139 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread/barrier.h"
+#include "thread/count_down_latch.h"
+
+// 用法: barrier_bench
+// 1. 4~64个线程反复同步，每个阶段的平均耗时：mutex + condition_variable实现的屏障、Barrier、合并树模式的Barrier
+// 2. 每轮一个CountDownLatch，所有线程CountDown后Await，每轮的平均耗时：之前加锁的实现和现在的原子计数
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// mutex + condition_variable的屏障，作为对照
+class LockedBarrier {
+   public:
+    explicit LockedBarrier(uint32_t count) : count_(count) {}
+
+    bool ArriveAndWait(uint32_t) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t phase = phase_;
+        if (++arrived_ == count_) {
+            arrived_ = 0;
+            ++phase_;
+            cv_.notify_all();
+            return true;
+        }
+        cv_.wait(lock, [&]() { return phase_ != phase; });
+        return false;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint32_t count_;
+    uint32_t arrived_ = 0;
+    uint64_t phase_ = 0;
+};
+
+// 之前的实现：一把锁保护的计数
+class LockedLatch {
+   public:
+    explicit LockedLatch(uint32_t count) : count_(count) {}
+
+    void CountDown() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (--count_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+    void Await() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]() { return count_ == 0; });
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint32_t count_;
+};
+
+template <typename Body>
+double RunThreads(int thread_num, Body body) {
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (int t = 0; t < thread_num; ++t) {
+        threads.emplace_back([&, t]() { body(static_cast<uint32_t>(t)); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// 返回每个阶段的微秒数，并检查completion每个阶段恰好执行一次
+template <typename B>
+double BenchBarrier(B& barrier, int thread_num, int phase_num) {
+    std::atomic<int> completed{0};
+    double us = RunThreads(thread_num, [&](uint32_t index) {
+        for (int phase = 0; phase < phase_num; ++phase) {
+            if (barrier.ArriveAndWait(index)) {
+                ++completed;
+            }
+        }
+    });
+    if (completed.load() != phase_num) {
+        std::cerr << "phase count mismatch: " << completed.load() << " != " << phase_num << std::endl;
+    }
+    return us / phase_num;
+}
+
+template <typename Latch>
+double BenchLatch(int thread_num, int round_num) {
+    std::vector<std::unique_ptr<Latch>> latches;
+    for (int round = 0; round < round_num; ++round) {
+        latches.emplace_back(new Latch(thread_num));
+    }
+    double us = RunThreads(thread_num, [&](uint32_t) {
+        for (auto& latch : latches) {
+            latch->CountDown();
+            latch->Await();
+        }
+    });
+    return us / round_num;
+}
+
+}  // namespace
+
+int main() {
+    std::cerr << "hardware threads " << std::thread::hardware_concurrency() << std::endl;
+    for (int thread_num : {4, 8, 16, 32, 64}) {
+        int phase_num = 200000 / thread_num;
+        LockedBarrier locked(thread_num);
+        wzq::Barrier central(thread_num);
+        wzq::Barrier tree(thread_num, 4);
+        double locked_us = BenchBarrier(locked, thread_num, phase_num);
+        double central_us = BenchBarrier(central, thread_num, phase_num);
+        double tree_us = BenchBarrier(tree, thread_num, phase_num);
+        std::cerr << thread_num << " threads, " << phase_num << " phases: mutex + cv " << locked_us
+                  << " us/phase, Barrier " << central_us << " us/phase, Barrier fan-in 4 " << tree_us
+                  << " us/phase" << std::endl;
+    }
+    for (int thread_num : {4, 8, 16, 32, 64}) {
+        int round_num = 200000 / thread_num;
+        double locked_us = BenchLatch<LockedLatch>(thread_num, round_num);
+        double atomic_us = BenchLatch<wzq::CountDownLatch>(thread_num, round_num);
+        std::cerr << thread_num << " threads, " << round_num << " latches: locked " << locked_us
+                  << " us/round, atomic " << atomic_us << " us/round" << std::endl;
+    }
+    return 0;
+}
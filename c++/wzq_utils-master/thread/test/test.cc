@@ -5,17 +5,17 @@
 #include "thread/thread_pool.h"
 
 void TestThreadPool() {
-    cout << "hello" << endl;
+    std::cout << "hello" << std::endl;
     wzq::ThreadPool pool(wzq::ThreadPool::ThreadPoolConfig{4, 5, 6, std::chrono::seconds(4)});
     pool.Start();
     std::this_thread::sleep_for(std::chrono::seconds(4));
-    cout << "thread size " << pool.GetTotalThreadSize() << endl;
+    std::cout << "thread size " << pool.GetTotalThreadSize() << std::endl;
     std::atomic<int> index;
     index.store(0);
     std::thread t([&]() {
         for (int i = 0; i < 10; ++i) {
             pool.Run([&]() {
-                cout << "function " << index.load() << endl;
+                std::cout << "function " << index.load() << std::endl;
                 std::this_thread::sleep_for(std::chrono::seconds(4));
                 index++;
             });
@@ -23,17 +23,17 @@ void TestThreadPool() {
         }
     });
     t.detach();
-    cout << "=================" << endl;
+    std::cout << "=================" << std::endl;
 
     std::this_thread::sleep_for(std::chrono::seconds(4));
     pool.Reset(wzq::ThreadPool::ThreadPoolConfig{4, 4, 6, std::chrono::seconds(4)});
     std::this_thread::sleep_for(std::chrono::seconds(4));
-    cout << "thread size " << pool.GetTotalThreadSize() << endl;
-    cout << "waiting size " << pool.GetWaitingThreadSize() << endl;
-    cout << "---------------" << endl;
+    std::cout << "thread size " << pool.GetTotalThreadSize() << std::endl;
+    std::cout << "waiting size " << pool.GetWaitingThreadSize() << std::endl;
+    std::cout << "---------------" << std::endl;
     // pool.ShutDownNow();
     getchar();
-    cout << "world" << endl;
+    std::cout << "world" << std::endl;
 }
 
 int main() {
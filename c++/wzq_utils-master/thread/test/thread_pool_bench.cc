@@ -0,0 +1,150 @@
+// 统计线程的创建和退出次数
+#define WZQ_THREAD_POOL_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "thread/thread_pool.h"
+
+// 用法: thread_pool_bench
+// 1. 4个核心线程，1个和4个提交线程，每秒执行的空任务个数，分别测试返回future的Run和不返回future的Execute
+// 2. 突发任务：每隔1.1s一次提交200个2ms的任务，不同扩缩容配置下任务从提交到执行完的延迟，以及线程创建和退出的次数
+// 3. 每批任务创建、销毁一个线程池的速度，以及ShutDownFor在任务执行不完时的返回时间
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Submit>
+double Bench(size_t count, int submit_thread_num, Submit submit) {
+    wzq::ThreadPool pool(wzq::ThreadPool::ThreadPoolConfig{4, 4, 0, std::chrono::seconds(4)});
+    pool.Start();
+
+    std::atomic<size_t> done{0};
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < submit_thread_num; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < count; i += submit_thread_num) {
+                submit(pool, done);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    while (done.load() < count) {
+        std::this_thread::yield();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    pool.ShutDown();
+    return count / seconds;
+}
+
+void BenchBurst(const char* name, wzq::ThreadPool::ThreadPoolConfig config) {
+    const int burst_num = 5;
+    const size_t burst_size = 200;
+    wzq::ThreadPool pool(config);
+    std::atomic<int> added{0};
+    std::atomic<int> exited{0};
+    std::atomic<int> max_threads{0};
+    pool.SetTraceHook([&](wzq::ThreadPool::TraceEvent event, int) {
+        if (event == wzq::ThreadPool::TraceEvent::kAddThread) {
+            ++added;
+        } else if (event == wzq::ThreadPool::TraceEvent::kThreadExit) {
+            ++exited;
+        }
+    });
+    pool.Start();
+
+    std::vector<int64_t> latency(burst_num * burst_size);
+    std::atomic<size_t> done{0};
+    for (int burst = 0; burst < burst_num; ++burst) {
+        auto burst_start = Clock::now();
+        for (size_t i = 0; i < burst_size; ++i) {
+            size_t index = burst * burst_size + i;
+            auto submit_time = Clock::now();
+            pool.Execute([&, index, submit_time]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                latency[index] =
+                    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - submit_time).count();
+                ++done;
+            });
+            int threads = pool.GetTotalThreadSize();
+            if (threads > max_threads.load()) {
+                max_threads.store(threads);
+            }
+        }
+        std::this_thread::sleep_until(burst_start + std::chrono::milliseconds(1100));
+    }
+    while (done.load() < latency.size()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    int end_threads = pool.GetTotalThreadSize();
+    pool.ShutDown();
+
+    std::sort(latency.begin(), latency.end());
+    std::cerr << name << ": latency p50 " << latency[latency.size() / 2] / 1000.0 << " ms, p99 "
+              << latency[latency.size() * 99 / 100] / 1000.0 << " ms, max " << latency.back() / 1000.0
+              << " ms; threads max " << max_threads.load() << ", end " << end_threads << ", created " << added.load()
+              << ", retired " << exited.load() << std::endl;
+}
+
+void BenchLifecycle(int round_num) {
+    std::atomic<size_t> done{0};
+    auto start = Clock::now();
+    for (int round = 0; round < round_num; ++round) {
+        wzq::ThreadPool pool(wzq::ThreadPool::ThreadPoolConfig{4, 4, 0, std::chrono::seconds(4)});
+        pool.Start();
+        for (int i = 0; i < 100; ++i) {
+            pool.Execute([&done]() { ++done; });
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    wzq::ThreadPool pool(wzq::ThreadPool::ThreadPoolConfig{4, 4, 0, std::chrono::seconds(4)});
+    pool.Start();
+    for (int i = 0; i < 1000; ++i) {
+        pool.Execute([]() { std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+    }
+    auto shutdown_start = Clock::now();
+    bool drained = pool.ShutDownFor(std::chrono::milliseconds(50));
+    double shutdown_ms = std::chrono::duration<double, std::milli>(Clock::now() - shutdown_start).count();
+
+    std::cerr << round_num << " pools with 4 threads and 100 tasks each: " << round_num / seconds
+              << " pools/s, tasks run " << done.load() << "; ShutDownFor(50ms) with 10s of queued work returned in "
+              << shutdown_ms << " ms, drained " << drained << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    const size_t count = 1000000;
+    for (int submit_thread_num : {1, 4}) {
+        double run = Bench(count, submit_thread_num, [](wzq::ThreadPool& pool, std::atomic<size_t>& done) {
+            pool.Run([&done]() { ++done; });
+        });
+        double execute = Bench(count, submit_thread_num, [](wzq::ThreadPool& pool, std::atomic<size_t>& done) {
+            pool.Execute([&done]() { ++done; });
+        });
+        std::cerr << count << " tasks, 4 core threads, " << submit_thread_num << " submit threads: Run "
+                  << run / 1e6 << " M tasks/s, Execute " << execute / 1e6 << " M tasks/s" << std::endl;
+    }
+
+    // 2个核心线程，最多16个，Cache线程空闲1s退出
+    wzq::ThreadPool::ThreadPoolConfig config{2, 16, 0, std::chrono::seconds(1)};
+    BenchBurst("grow when no thread waiting", config);
+    config.grow_queue_depth = 8;
+    config.grow_wait_time = std::chrono::milliseconds(2);
+    config.cool_down = std::chrono::milliseconds(200);
+    BenchBurst("depth 8 / wait 2ms / cool down 200ms", config);
+    config.max_task_size = 64;
+    BenchBurst("same, queue bounded at 64", config);
+
+    BenchLifecycle(1000);
+    return 0;
+}
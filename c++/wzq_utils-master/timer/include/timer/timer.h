@@ -1,26 +1,67 @@
 #ifndef __TIMER__
 #define __TIMER__
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <iostream>
-#include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
 
-#include "common/map.h"
 #include "thread/thread_pool.h"
+#include "timer/timing_wheel.h"
 
 namespace wzq {
+/**
+ * 定时器队列，到期的函数放到线程池中执行
+ * 定时器存放在分层时间轮中，插入和删除都是O(1)；tick是时间轮的精度，定时器最多晚一个tick到期
+ * 各线程先把定时器放到自己的插入缓冲区，分发线程每次醒来时再统一放进时间轮，插入线程之间不会争同一把锁
+ * 只有新定时器比分发线程计划醒来的时间更早时才重新设置醒来的时间
+ * 同一时刻到期的定时器在一次加锁中取出，作为一批交给线程池
+ * linux上分发线程阻塞在timerfd上，插入线程直接修改timerfd的到期时间，不需要先唤醒分发线程；其他平台用条件变量
+ * 时间基准是单调的steady_clock，修改系统时间不会让定时器提前或推迟
+ */
 class TimerQueue {
    public:
-    struct InternalS {
-        std::chrono::time_point<std::chrono::high_resolution_clock> time_point_;
-        std::function<void()> func_;
-        int repeated_id;
-        bool operator<(const InternalS& b) const { return time_point_ > b.time_point_; }
+    using Clock = std::chrono::steady_clock;
+
+   private:
+    struct TimerTask;
+
+   public:
+    /**
+     * Add*返回的定时器句柄，可以复制，不能在TimerQueue销毁后使用
+     * Cancel: 取消还没有执行的定时器，定时器立即从时间轮中删除，O(1)
+     * Reschedule: 把还没有到期的定时器改为从现在起time之后到期，O(1)
+     */
+    class Handle {
+       public:
+        Handle() = default;
+
+        bool Cancel();
+
+        template <typename R, typename P>
+        bool Reschedule(const std::chrono::duration<R, P>& time);
+
+        // 定时器还在等待到期
+        bool IsPending();
+
+       private:
+        friend class TimerQueue;
+        Handle(TimerQueue* queue, const std::shared_ptr<TimerTask>& task) : queue_(queue), task_(task) {}
+
+        TimerQueue* queue_ = nullptr;
+        std::weak_ptr<TimerTask> task_;
     };
 
    public:
@@ -29,118 +70,433 @@ class TimerQueue {
         if (!ret) {
             return false;
         }
-        std::thread([this]() { RunLocal(); }).detach();
+        dispatcher_ = std::thread([this]() { RunLocal(); });
         return true;
     }
 
     bool IsAvailable() { return thread_pool_.IsAvailable(); }
 
-    int Size() { return queue_.size(); }
+    // 还没有到期的定时器个数，取消的定时器立即扣除
+    int Size() { return size_.load(); }
+
+    /**
+     * 每批到期的定时器中，先在分发线程上直接执行，累计执行时间超过budget后剩下的才交给线程池
+     * 省去了线程池的调度开销，只适合很短、不会阻塞的函数；默认为0，全部交给线程池
+     */
+    void SetInlineBudget(std::chrono::microseconds budget) { inline_budget_us_.store(budget.count()); }
+
+    /**
+     * 定时器允许推迟slack执行，分发线程醒来的时间向上对齐到slack的整数倍，相近的定时器在一次唤醒中一起到期
+     * 减少了唤醒次数，代价是定时器最多晚slack；默认为0，每个tick都可以醒来
+     */
+    void SetTimerSlack(std::chrono::microseconds slack) {
+        slack_ticks_.store(std::max<uint64_t>(1, slack.count() / tick_.count()));
+    }
+
+    // 分发线程被唤醒的次数
+    uint64_t GetWakeupNum() { return wakeup_num_.load(); }
 
     void Stop() {
-        running_.store(false);
-        cond_.notify_all();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            running_.store(false);
+            // tick 0已经过去，timerfd立即到期
+            WakeLocked(0);
+        }
+        if (dispatcher_.joinable() && dispatcher_.get_id() != std::this_thread::get_id()) {
+            dispatcher_.join();
+        }
         thread_pool_.ShutDown();
     }
 
     template <typename R, typename P, typename F, typename... Args>
-    void AddFuncAfterDuration(const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
-        InternalS s;
-        s.time_point_ = std::chrono::high_resolution_clock::now() + time;
-        s.func_ = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        std::unique_lock<std::mutex> lock(mutex_);
-        queue_.push(s);
-        cond_.notify_all();
+    Handle AddFuncAfterDuration(const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
+        auto task = NewTask(std::forward<F>(f), std::forward<Args>(args)...);
+        task->expire_tick_ = TickAt(Clock::now() + time, true);
+        return Insert(task);
     }
 
     template <typename F, typename... Args>
-    void AddFuncAtTimePoint(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point, F&& f,
-                            Args&&... args) {
-        InternalS s;
-        s.time_point_ = time_point;
-        s.func_ = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        std::unique_lock<std::mutex> lock(mutex_);
-        queue_.push(s);
-        cond_.notify_all();
+    Handle AddFuncAtTimePoint(const std::chrono::time_point<Clock>& time_point, F&& f, Args&&... args) {
+        auto task = NewTask(std::forward<F>(f), std::forward<Args>(args)...);
+        task->expire_tick_ = TickAt(time_point, true);
+        return Insert(task);
     }
 
+    // 每隔time执行一次，共执行repeat_num次，下一次从本次执行完开始计时
     template <typename R, typename P, typename F, typename... Args>
-    int AddRepeatedFunc(int repeat_num, const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
-        int id = GetNextRepeatedFuncId();
-        repeated_id_state_map_.Emplace(id, RepeatedIdState::kRunning);
-        auto tem_func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        AddRepeatedFuncLocal(repeat_num - 1, time, id, std::move(tem_func));
-        return id;
+    Handle AddRepeatedFunc(int repeat_num, const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
+        auto task = NewTask(std::forward<F>(f), std::forward<Args>(args)...);
+        task->repeat_left_ = repeat_num - 1;
+        task->interval_ = std::chrono::duration_cast<Clock::duration>(time);
+        task->expire_tick_ = TickAt(Clock::now() + time, true);
+        return Insert(task);
     }
 
-    void CancelRepeatedFuncId(int func_id) { repeated_id_state_map_.EraseKey(func_id); }
-
-    int GetNextRepeatedFuncId() { return repeated_func_id_++; }
-
-    TimerQueue() : thread_pool_(wzq::ThreadPool::ThreadPoolConfig{4, 4, 40, std::chrono::seconds(4)}) {
-        repeated_func_id_.store(0);
+    // tick: 时间轮的精度；线程池的队列不限长度，分发线程不会阻塞在线程池上
+    explicit TimerQueue(std::chrono::microseconds tick = std::chrono::milliseconds(1))
+        : thread_pool_(wzq::ThreadPool::ThreadPoolConfig{4, 4, 0, std::chrono::seconds(4)}),
+          tick_(tick.count() > 0 ? tick : std::chrono::microseconds(1)),
+          start_time_(Clock::now()) {
         running_.store(true);
+#ifdef __linux__
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+#endif
     }
 
-    ~TimerQueue() { Stop(); }
-
-    enum class RepeatedIdState { kInit = 0, kRunning = 1, kStop = 2 };
+    ~TimerQueue() {
+        Stop();
+        std::vector<TimerNode*> nodes;
+        {
+            std::unique_lock<std::mutex> lock(wheel_mutex_);
+            wheel_.Clear(nodes);
+            for (auto& buffer : insert_buffers_) {
+                nodes.insert(nodes.end(), buffer.tasks_.begin(), buffer.tasks_.end());
+            }
+            for (TimerNode* node : nodes) {
+                TimerTask* task = static_cast<TimerTask*>(node);
+                task->state_ = TaskState::kCanceled;
+                task->self_.reset();
+            }
+        }
+#ifdef __linux__
+        if (timer_fd_ >= 0) {
+            close(timer_fd_);
+        }
+#endif
+    }
 
    private:
+    enum class TaskState { kBuffered = 0, kInWheel = 1, kRunning = 2, kCanceled = 3 };
+
+    // 定时器由self_持有，直到执行完或者被取消；句柄只持有weak_ptr
+    struct TimerTask : TimerNode {
+        std::function<void()> func_;
+        int repeat_left_ = 0;
+        Clock::duration interval_{};
+
+        // 由wheel_mutex_保护
+        TaskState state_ = TaskState::kBuffered;
+        // 执行中时只有执行线程访问，其他时候由wheel_mutex_保护
+        std::shared_ptr<TimerTask> self_;
+    };
+
+    struct alignas(64) InsertBuffer {
+        std::mutex mutex_;
+        std::vector<TimerNode*> tasks_;
+    };
+
+    static constexpr size_t kInsertBufferNum = 16;
+
+    static size_t LocalBufferIndex() {
+        static std::atomic<size_t> next_index{0};
+        thread_local size_t index = next_index++ % kInsertBufferNum;
+        return index;
+    }
+
+    template <typename F, typename... Args>
+    static std::shared_ptr<TimerTask> NewTask(F&& f, Args&&... args) {
+        auto task = std::make_shared<TimerTask>();
+        task->func_ = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+        return task;
+    }
+
     void RunLocal() {
+        std::vector<TimerNode*> inserted;
+        std::vector<TimerNode*> expired;
+        std::vector<std::shared_ptr<TimerTask>> canceled;
+        std::vector<std::function<void()>> batch;
         while (running_.load()) {
+            {
+                std::unique_lock<std::mutex> lock(wheel_mutex_);
+                DrainInsertBuffers(inserted, canceled);
+                wheel_.Advance(TickAt(Clock::now(), false), expired);
+                for (TimerNode* node : expired) {
+                    static_cast<TimerTask*>(node)->state_ = TaskState::kRunning;
+                }
+            }
+            // 在锁外释放，避免在锁内析构用户的函数对象
+            canceled.clear();
+
+            Dispatch(expired, batch);
+            expired.clear();
+
             std::unique_lock<std::mutex> lock(mutex_);
-            if (queue_.empty()) {
-                cond_.wait(lock);
+            uint64_t wake_tick = SlackTick(NextTick());
+            next_wake_tick_.store(wake_tick);
+            if (!running_.load() || buffered_num_.load() > 0) {
                 continue;
             }
-            auto s = queue_.top();
-            auto diff = s.time_point_ - std::chrono::high_resolution_clock::now();
-            if (std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() > 0) {
-                cond_.wait_for(lock, diff);
-                continue;
-            } else {
-                queue_.pop();
-                lock.unlock();
-                thread_pool_.Run(std::move(s.func_));
+            Sleep(lock, wake_tick);
+            ++wakeup_num_;
+        }
+    }
+
+    // 需要持有mutex_，睡到wake_tick或者被WakeLocked唤醒
+    void Sleep(std::unique_lock<std::mutex>& lock, uint64_t wake_tick) {
+#ifdef __linux__
+        if (timer_fd_ >= 0) {
+            if (wake_tick != armed_tick_) {
+                ArmTimerFd(wake_tick);
+            }
+            lock.unlock();
+            // timerfd重新设置时会清掉之前的到期次数，读到的一定是最近一次设置的到期
+            uint64_t expirations = 0;
+            if (read(timer_fd_, &expirations, sizeof(expirations)) < 0) {
+                // 被信号打断，重新检查一遍
+            }
+            return;
+        }
+#endif
+        if (wake_tick == TimingWheel::kNoTick) {
+            cond_.wait(lock);
+        } else {
+            cond_.wait_until(lock, start_time_ + tick_ * wake_tick);
+        }
+    }
+
+    // 需要持有mutex_，让分发线程不晚于tick醒来
+    void WakeLocked(uint64_t tick) {
+#ifdef __linux__
+        if (timer_fd_ >= 0) {
+            if (tick < armed_tick_) {
+                ArmTimerFd(tick);
+            }
+            return;
+        }
+#endif
+        cond_.notify_one();
+    }
+
+#ifdef __linux__
+    // 需要持有mutex_，kNoTick表示停止timerfd；使用绝对时间，steady_clock和CLOCK_MONOTONIC是同一个时钟
+    void ArmTimerFd(uint64_t tick) {
+        armed_tick_ = tick;
+        itimerspec spec{};
+        if (tick != TimingWheel::kNoTick) {
+            auto deadline = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                (start_time_ + tick_ * tick).time_since_epoch())
+                                .count();
+            // 全0表示停止timerfd
+            deadline = std::max<int64_t>(deadline, 1);
+            spec.it_value.tv_sec = deadline / 1000000000;
+            spec.it_value.tv_nsec = deadline % 1000000000;
+        }
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+#endif
+
+    // 按slack向上对齐
+    uint64_t SlackTick(uint64_t tick) const {
+        uint64_t slack = slack_ticks_.load();
+        if (tick == TimingWheel::kNoTick || slack <= 1) {
+            return tick;
+        }
+        return (tick + slack - 1) / slack * slack;
+    }
+
+    // 先在分发线程上执行不超过inline_budget_us_的时间，剩下的作为一批交给线程池
+    void Dispatch(const std::vector<TimerNode*>& expired, std::vector<std::function<void()>>& batch) {
+        size_ -= expired.size();
+        auto budget = std::chrono::microseconds(inline_budget_us_.load());
+        auto inline_end = Clock::now() + budget;
+        size_t index = 0;
+        while (budget.count() > 0 && index < expired.size() && Clock::now() < inline_end) {
+            RunTask(static_cast<TimerTask*>(expired[index++]));
+        }
+        for (size_t i = index; i < expired.size(); ++i) {
+            TimerTask* task = static_cast<TimerTask*>(expired[i]);
+            batch.emplace_back([this, task]() { RunTask(task); });
+        }
+        if (!thread_pool_.RunBatch(batch)) {
+            // 线程池已经关闭，定时器不会再执行
+            for (size_t i = index; i < expired.size(); ++i) {
+                std::shared_ptr<TimerTask> self = std::move(static_cast<TimerTask*>(expired[i])->self_);
+            }
+            batch.clear();
+        }
+    }
+
+    uint64_t NextTick() {
+        std::unique_lock<std::mutex> lock(wheel_mutex_);
+        return wheel_.NextTick();
+    }
+
+    Handle Insert(const std::shared_ptr<TimerTask>& task) {
+        ++size_;
+        task->self_ = task;
+        Push(task.get());
+        return Handle(this, task);
+    }
+
+    void Push(TimerTask* task) {
+        // 放入缓冲区后task可能已被执行、重新调度或释放，不能再访问
+        uint64_t expire_tick = task->expire_tick_;
+        {
+            InsertBuffer& buffer = insert_buffers_[LocalBufferIndex()];
+            std::unique_lock<std::mutex> lock(buffer.mutex_);
+            buffer.tasks_.push_back(task);
+        }
+        ++buffered_num_;
+        WakeBefore(expire_tick);
+    }
+
+    // 出现新的最早到期时间才唤醒分发线程
+    void WakeBefore(uint64_t tick) {
+        tick = SlackTick(tick);
+        uint64_t wake_tick = next_wake_tick_.load();
+        while (tick < wake_tick) {
+            if (next_wake_tick_.compare_exchange_weak(wake_tick, tick)) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                WakeLocked(tick);
+                break;
             }
         }
     }
 
-    template <typename R, typename P, typename F>
-    void AddRepeatedFuncLocal(int repeat_num, const std::chrono::duration<R, P>& time, int id, F&& f) {
-        if (!this->repeated_id_state_map_.IsKeyExist(id)) {
+    // 需要持有wheel_mutex_
+    void DrainInsertBuffers(std::vector<TimerNode*>& inserted, std::vector<std::shared_ptr<TimerTask>>& canceled) {
+        for (auto& buffer : insert_buffers_) {
+            {
+                std::unique_lock<std::mutex> lock(buffer.mutex_);
+                inserted.swap(buffer.tasks_);
+            }
+            buffered_num_ -= inserted.size();
+            for (TimerNode* node : inserted) {
+                TimerTask* task = static_cast<TimerTask*>(node);
+                if (task->state_ == TaskState::kCanceled) {
+                    canceled.push_back(std::move(task->self_));
+                    continue;
+                }
+                task->state_ = TaskState::kInWheel;
+                wheel_.Add(node);
+            }
+            inserted.clear();
+        }
+    }
+
+    // 执行中的定时器仍由self_持有，只有执行线程会释放它
+    void RunTask(TimerTask* task) {
+        task->func_();
+        std::shared_ptr<TimerTask> self;
+        if (task->repeat_left_ <= 0) {
+            self = std::move(task->self_);
             return;
         }
-        InternalS s;
-        s.time_point_ = std::chrono::high_resolution_clock::now() + time;
-        auto tem_func = std::move(f);
-        s.repeated_id = id;
-        s.func_ = [this, &tem_func, repeat_num, time, id]() {
-            tem_func();
-            if (!this->repeated_id_state_map_.IsKeyExist(id) || repeat_num == 0) {
+        {
+            std::unique_lock<std::mutex> lock(wheel_mutex_);
+            if (task->state_ == TaskState::kCanceled) {
+                self = std::move(task->self_);
                 return;
             }
-            AddRepeatedFuncLocal(repeat_num - 1, time, id, std::move(tem_func));
-        };
-        std::unique_lock<std::mutex> lock(mutex_);
-        queue_.push(s);
-        lock.unlock();
-        cond_.notify_all();
+            --task->repeat_left_;
+            task->state_ = TaskState::kBuffered;
+            task->expire_tick_ = TickAt(Clock::now() + task->interval_, true);
+        }
+        ++size_;
+        Push(task);
+    }
+
+    bool Cancel(const std::shared_ptr<TimerTask>& task) {
+        std::shared_ptr<TimerTask> self;
+        {
+            std::unique_lock<std::mutex> lock(wheel_mutex_);
+            switch (task->state_) {
+                case TaskState::kInWheel:
+                    wheel_.Remove(task.get());
+                    self = std::move(task->self_);
+                    break;
+                case TaskState::kBuffered:
+                    // 还在插入缓冲区中，分发线程取出时丢弃
+                    break;
+                case TaskState::kRunning:
+                    // 重复执行的定时器不再加入
+                    task->state_ = TaskState::kCanceled;
+                    return task->repeat_left_ > 0;
+                case TaskState::kCanceled:
+                    return false;
+            }
+            task->state_ = TaskState::kCanceled;
+        }
+        --size_;
+        return true;
+    }
+
+    bool Reschedule(const std::shared_ptr<TimerTask>& task, Clock::duration time) {
+        uint64_t expire_tick = TickAt(Clock::now() + time, true);
+        {
+            std::unique_lock<std::mutex> lock(wheel_mutex_);
+            if (task->state_ == TaskState::kInWheel) {
+                wheel_.Remove(task.get());
+                task->expire_tick_ = expire_tick;
+                wheel_.Add(task.get());
+            } else if (task->state_ == TaskState::kBuffered) {
+                task->expire_tick_ = expire_tick;
+            } else {
+                return false;
+            }
+        }
+        WakeBefore(expire_tick);
+        return true;
+    }
+
+    // 时间点所在的tick，到期时间向上取整，保证定时器不会提前到期
+    uint64_t TickAt(const Clock::time_point& time_point, bool round_up) const {
+        if (time_point <= start_time_) {
+            return 0;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time_point - start_time_).count();
+        auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(tick_).count();
+        return round_up ? (elapsed + tick - 1) / tick : elapsed / tick;
     }
 
    private:
-    std::priority_queue<InternalS> queue_;
     std::atomic<bool> running_;
     std::mutex mutex_;
     std::condition_variable cond_;
+    std::thread dispatcher_;
+    // 以下两个由mutex_保护；timer_fd_小于0时退回到条件变量
+    int timer_fd_ = -1;
+    uint64_t armed_tick_ = TimingWheel::kNoTick;
+    std::atomic<uint64_t> slack_ticks_{1};
+    std::atomic<uint64_t> wakeup_num_{0};
 
     wzq::ThreadPool thread_pool_;
 
-    std::atomic<int> repeated_func_id_;
-    wzq::ThreadSafeMap<int, RepeatedIdState> repeated_id_state_map_;
+    const std::chrono::microseconds tick_;
+    const Clock::time_point start_time_;
+
+    // 分发线程推进时间轮，其他线程取消和改期定时器，都在wheel_mutex_内
+    std::mutex wheel_mutex_;
+    TimingWheel wheel_;
+    std::atomic<uint64_t> next_wake_tick_{TimingWheel::kNoTick};
+
+    std::array<InsertBuffer, kInsertBufferNum> insert_buffers_;
+    std::atomic<size_t> buffered_num_{0};
+    std::atomic<int> size_{0};
+    std::atomic<int64_t> inline_budget_us_{0};
 };
 
+inline bool TimerQueue::Handle::Cancel() {
+    auto task = task_.lock();
+    return task && queue_->Cancel(task);
+}
+
+template <typename R, typename P>
+bool TimerQueue::Handle::Reschedule(const std::chrono::duration<R, P>& time) {
+    auto task = task_.lock();
+    return task && queue_->Reschedule(task, std::chrono::duration_cast<Clock::duration>(time));
+}
+
+inline bool TimerQueue::Handle::IsPending() {
+    auto task = task_.lock();
+    if (!task) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(queue_->wheel_mutex_);
+    return task->state_ == TaskState::kBuffered || task->state_ == TaskState::kInWheel;
+}
+
 }  // namespace wzq
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,189 @@
+#ifndef __TIMING_WHEEL__
+#define __TIMING_WHEEL__
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common/noncopyable.h"
+
+namespace wzq {
+
+// 时间轮上的定时器节点，侵入式双向链表，插入和删除都是O(1)
+struct TimerNode {
+    TimerNode* prev_ = nullptr;
+    TimerNode* next_ = nullptr;
+    uint64_t expire_tick_ = 0;
+
+    bool IsLinked() const { return next_ != nullptr; }
+};
+
+/**
+ * 分层时间轮，参考linux内核的实现
+ * 第0层256个槽，每槽1个tick；之后4层每层64个槽，每层的一个槽覆盖下一层一整圈，共覆盖2^32个tick
+ * 到期时间超过2^32个tick的节点先放到最高层，转到时再重新放置
+ * 时间轮本身不加锁，由使用者保证同一时间只有一个线程访问
+ */
+class TimingWheel : NonCopyAble {
+   public:
+    static constexpr uint64_t kNoTick = std::numeric_limits<uint64_t>::max();
+
+    explicit TimingWheel(uint64_t start_tick = 0) : current_tick_(start_tick) {
+        for (auto& slot : near_) {
+            InitSlot(slot);
+        }
+        for (auto& level : levels_) {
+            for (auto& slot : level) {
+                InitSlot(slot);
+            }
+        }
+    }
+
+    // 到期时间早于当前tick的节点在下一次Advance时到期
+    void Add(TimerNode* node) {
+        uint64_t expire = node->expire_tick_ < current_tick_ ? current_tick_ : node->expire_tick_;
+        uint64_t delta = expire - current_tick_;
+        TimerNode* slot = nullptr;
+        if (delta < kNearSize) {
+            slot = &near_[expire & kNearMask];
+        } else {
+            if (delta > kMaxDelta) {
+                expire = current_tick_ + kMaxDelta;
+            }
+            int level = 0;
+            while (delta >= (kNearSize << ((level + 1) * kLevelBits)) && level < kLevelNum - 1) {
+                ++level;
+            }
+            slot = &levels_[level][(expire >> (kNearBits + level * kLevelBits)) & kLevelMask];
+        }
+        LinkBefore(slot, node);
+        ++size_;
+    }
+
+    void Remove(TimerNode* node) {
+        if (!node->IsLinked()) {
+            return;
+        }
+        node->prev_->next_ = node->next_;
+        node->next_->prev_ = node->prev_;
+        node->prev_ = nullptr;
+        node->next_ = nullptr;
+        --size_;
+    }
+
+    // 推进到now_tick(包含)，到期的节点按到期顺序追加到expired，并从时间轮中摘除
+    void Advance(uint64_t now_tick, std::vector<TimerNode*>& expired) {
+        while (current_tick_ <= now_tick) {
+            if (size_ == 0) {
+                current_tick_ = now_tick + 1;
+                break;
+            }
+            size_t index = current_tick_ & kNearMask;
+            if (index == 0) {
+                Cascade();
+            }
+            TimerNode* slot = &near_[index];
+            while (slot->next_ != slot) {
+                TimerNode* node = slot->next_;
+                Remove(node);
+                expired.push_back(node);
+            }
+            ++current_tick_;
+        }
+    }
+
+    // 下一个需要处理的tick：第0层最近的非空槽，或者下一次从上层搬移节点的tick
+    uint64_t NextTick() const {
+        if (size_ == 0) {
+            return kNoTick;
+        }
+        if ((current_tick_ & kNearMask) == 0) {
+            return current_tick_;
+        }
+        uint64_t cascade_tick = (current_tick_ | kNearMask) + 1;
+        for (uint64_t tick = current_tick_; tick < cascade_tick; ++tick) {
+            const TimerNode& slot = near_[tick & kNearMask];
+            if (slot.next_ != &slot) {
+                return tick;
+            }
+        }
+        return cascade_tick;
+    }
+
+    // 摘除所有节点，用于销毁时释放
+    void Clear(std::vector<TimerNode*>& nodes) {
+        auto clear_slot = [this, &nodes](TimerNode& slot) {
+            while (slot.next_ != &slot) {
+                TimerNode* node = slot.next_;
+                Remove(node);
+                nodes.push_back(node);
+            }
+        };
+        for (auto& slot : near_) {
+            clear_slot(slot);
+        }
+        for (auto& level : levels_) {
+            for (auto& slot : level) {
+                clear_slot(slot);
+            }
+        }
+    }
+
+    uint64_t CurrentTick() const { return current_tick_; }
+
+    size_t Size() const { return size_; }
+
+   private:
+    static constexpr int kNearBits = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevelNum = 4;
+    static constexpr uint64_t kNearSize = 1ULL << kNearBits;
+    static constexpr uint64_t kNearMask = kNearSize - 1;
+    static constexpr uint64_t kLevelSize = 1ULL << kLevelBits;
+    static constexpr uint64_t kLevelMask = kLevelSize - 1;
+    static constexpr uint64_t kMaxDelta = (1ULL << (kNearBits + kLevelNum * kLevelBits)) - 1;
+
+    static void InitSlot(TimerNode& slot) {
+        slot.prev_ = &slot;
+        slot.next_ = &slot;
+    }
+
+    static void LinkBefore(TimerNode* slot, TimerNode* node) {
+        node->prev_ = slot->prev_;
+        node->next_ = slot;
+        slot->prev_->next_ = node;
+        slot->prev_ = node;
+    }
+
+    // 第0层转完一圈时，把上层当前槽的节点重新放置到下层
+    void Cascade() {
+        for (int level = 0; level < kLevelNum; ++level) {
+            size_t index = (current_tick_ >> (kNearBits + level * kLevelBits)) & kLevelMask;
+            TimerNode* slot = &levels_[level][index];
+            TimerNode* node = slot->next_;
+            InitSlot(*slot);
+            while (node != slot) {
+                TimerNode* next = node->next_;
+                node->prev_ = nullptr;
+                node->next_ = nullptr;
+                --size_;
+                Add(node);
+                node = next;
+            }
+            if (index != 0) {
+                break;
+            }
+        }
+    }
+
+   private:
+    uint64_t current_tick_ = 0;
+    size_t size_ = 0;
+    std::array<TimerNode, kNearSize> near_;
+    std::array<std::array<TimerNode, kLevelSize>, kLevelNum> levels_;
+};
+
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "timer/timer.h"
+#include "timer/timing_wheel.h"
+
+// 用法: timer_bench，结果输出到stderr
+// 1. 时间轮本身与std::priority_queue的插入、删除、到期速度，10k/1M/10M个定时器
+// 2. TimerQueue端到端的插入速度和到期延迟
+// 3. 95%的定时器在到期前取消时，队列中剩余的定时器个数和浪费的分发次数
+// 4. 大量定时器同时到期时，从到期到开始执行的延迟分布，分别测试全部交给线程池和在分发线程上直接执行一部分
+// 5. 定时器稳定地陆续加入时，分发线程每秒被唤醒的次数和到期精度，分别测试不同的timer slack
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+void BenchEngine(size_t count) {
+    const uint64_t max_tick = 60000;  // 1ms一个tick时为1分钟
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<uint64_t> ticks(1, max_tick);
+
+    std::vector<wzq::TimerNode> nodes(count);
+    for (auto& node : nodes) {
+        node.expire_tick_ = ticks(random);
+    }
+
+    wzq::TimingWheel wheel;
+    auto start = Clock::now();
+    for (auto& node : nodes) {
+        wheel.Add(&node);
+    }
+    double insert_time = Seconds(start);
+
+    // 一半的定时器在到期前取消
+    start = Clock::now();
+    for (size_t i = 0; i < count; i += 2) {
+        wheel.Remove(&nodes[i]);
+    }
+    double cancel_time = Seconds(start);
+
+    std::vector<wzq::TimerNode*> expired;
+    expired.reserve(count);
+    start = Clock::now();
+    wheel.Advance(max_tick, expired);
+    double fire_time = Seconds(start);
+
+    using Entry = std::pair<uint64_t, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        heap.emplace(nodes[i].expire_tick_, i);
+    }
+    double heap_insert_time = Seconds(start);
+    start = Clock::now();
+    while (!heap.empty()) {
+        heap.pop();
+    }
+    double heap_fire_time = Seconds(start);
+
+    std::cerr << count << " timers, wheel: insert " << count / insert_time / 1e6 << " M/s, cancel "
+              << count / 2 / cancel_time / 1e6 << " M/s, fire " << expired.size() / fire_time / 1e6
+              << " M/s; heap: insert " << count / heap_insert_time / 1e6 << " M/s, pop "
+              << count / heap_fire_time / 1e6 << " M/s" << std::endl;
+}
+
+void BenchTimerQueue(size_t count, int thread_num) {
+    wzq::TimerQueue queue;
+    queue.Run();
+
+    std::mutex mutex;
+    std::vector<int64_t> lateness;
+    lateness.reserve(count);
+    std::atomic<size_t> fired{0};
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(t);
+            std::uniform_int_distribution<int> delays(100, 1000);
+            for (size_t i = t; i < count; i += thread_num) {
+                auto due = wzq::TimerQueue::Clock::now() + std::chrono::milliseconds(delays(random));
+                queue.AddFuncAtTimePoint(due, [&, due]() {
+                    auto late = std::chrono::duration_cast<std::chrono::microseconds>(
+                                    wzq::TimerQueue::Clock::now() - due).count();
+                    std::unique_lock<std::mutex> lock(mutex);
+                    lateness.push_back(late);
+                    ++fired;
+                });
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double insert_time = Seconds(start);
+
+    while (fired.load() < count) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double total_time = Seconds(start);
+    queue.Stop();
+
+    std::sort(lateness.begin(), lateness.end());
+    int64_t sum = 0;
+    for (int64_t late : lateness) {
+        sum += late;
+    }
+    std::cerr << count << " timers, queue: insert " << count / insert_time / 1e6 << " M/s from " << thread_num
+              << " threads, all fired in " << total_time << " s, lateness avg " << sum / int64_t(count) << " us, p50 "
+              << lateness[count / 2] << " us, p99 " << lateness[count * 99 / 100] << " us, max " << lateness.back()
+              << " us" << std::endl;
+}
+
+void BenchCancel(size_t count, int cancel_percent) {
+    wzq::TimerQueue queue;
+    queue.Run();
+
+    std::atomic<size_t> fired{0};
+    std::atomic<size_t> wasted{0};
+    std::vector<std::atomic<bool>> canceled(count);
+    std::vector<wzq::TimerQueue::Handle> handles;
+    handles.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        canceled[i] = false;
+        handles.push_back(queue.AddFuncAfterDuration(std::chrono::milliseconds(1000 + i % 300), [&, i]() {
+            if (canceled[i]) {
+                ++wasted;
+            }
+            ++fired;
+        }));
+    }
+
+    auto start = Clock::now();
+    size_t cancel_num = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<int>(i % 100) < cancel_percent) {
+            canceled[i] = true;
+            handles[i].Cancel();
+            ++cancel_num;
+        }
+    }
+    double cancel_time = Seconds(start);
+    int size_after_cancel = queue.Size();
+
+    while (fired.load() < count - cancel_num && Seconds(start) < 10) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    queue.Stop();
+
+    std::cerr << count << " timers, " << cancel_percent << "% canceled: cancel " << cancel_num / cancel_time / 1e6
+              << " M/s, pending after cancel " << size_after_cancel << ", dispatched " << fired.load() << ", wasted "
+              << wasted.load() << std::endl;
+}
+
+void BenchLag(size_t count, std::chrono::microseconds inline_budget) {
+    wzq::TimerQueue queue;
+    queue.SetInlineBudget(inline_budget);
+    queue.Run();
+
+    std::vector<int64_t> lags(count);
+    std::atomic<size_t> fired{0};
+    auto due = wzq::TimerQueue::Clock::now() + std::chrono::milliseconds(500);
+    for (size_t i = 0; i < count; ++i) {
+        queue.AddFuncAtTimePoint(due, [&, i]() {
+            lags[i] = std::chrono::duration_cast<std::chrono::microseconds>(wzq::TimerQueue::Clock::now() - due)
+                          .count();
+            ++fired;
+        });
+    }
+    while (fired.load() < count) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    queue.Stop();
+
+    const int64_t bounds[] = {100, 1000, 10000, 100000};
+    size_t buckets[5] = {0};
+    for (int64_t lag : lags) {
+        size_t bucket = 0;
+        while (bucket < 4 && lag >= bounds[bucket]) {
+            ++bucket;
+        }
+        ++buckets[bucket];
+    }
+    std::sort(lags.begin(), lags.end());
+    std::cerr << count << " timers due at once, inline budget " << inline_budget.count() << " us: lag p50 "
+              << lags[count / 2] << " us, p99 " << lags[count * 99 / 100] << " us, max " << lags.back()
+              << " us; <100us " << buckets[0] << ", <1ms " << buckets[1] << ", <10ms " << buckets[2] << ", <100ms "
+              << buckets[3] << ", >=100ms " << buckets[4] << std::endl;
+}
+
+void BenchWakeup(std::chrono::microseconds interval, std::chrono::microseconds slack) {
+    const int thread_num = 2;
+    const auto duration = std::chrono::seconds(2);
+    wzq::TimerQueue queue;
+    queue.SetTimerSlack(slack);
+    queue.Run();
+
+    std::mutex mutex;
+    std::vector<int64_t> lateness;
+    std::atomic<size_t> added{0};
+    std::atomic<size_t> fired{0};
+
+    // 每个线程每隔interval加入一个1~50ms后到期的定时器
+    auto start = Clock::now();
+    uint64_t start_wakeup = queue.GetWakeupNum();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(t);
+            std::uniform_int_distribution<int> delays(1000, 50000);
+            while (Clock::now() - start < duration) {
+                auto due = wzq::TimerQueue::Clock::now() + std::chrono::microseconds(delays(random));
+                queue.AddFuncAtTimePoint(due, [&, due]() {
+                    auto late = std::chrono::duration_cast<std::chrono::microseconds>(
+                                    wzq::TimerQueue::Clock::now() - due).count();
+                    std::unique_lock<std::mutex> lock(mutex);
+                    lateness.push_back(late);
+                    ++fired;
+                });
+                ++added;
+                std::this_thread::sleep_for(interval);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    while (fired.load() < added.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double seconds = Seconds(start);
+    uint64_t wakeup = queue.GetWakeupNum() - start_wakeup;
+    queue.Stop();
+
+    std::sort(lateness.begin(), lateness.end());
+    size_t count = lateness.size();
+    std::cerr << count << " timers in " << seconds << " s, interval " << interval.count() << " us, slack "
+              << slack.count() << " us: " << wakeup / seconds
+              << " wakeups/s, lateness p50 " << lateness[count / 2] << " us, p99 " << lateness[count * 99 / 100]
+              << " us, max " << lateness.back() << " us" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    for (size_t count : {10000, 1000000, 10000000}) {
+        BenchEngine(count);
+    }
+    for (size_t count : {10000, 1000000}) {
+        BenchTimerQueue(count, 4);
+    }
+    BenchCancel(1000000, 95);
+    for (int budget : {0, 500}) {
+        BenchLag(100000, std::chrono::microseconds(budget));
+    }
+    for (int interval : {100, 5000}) {
+        for (int slack : {0, 2000, 8000}) {
+            BenchWakeup(std::chrono::microseconds(interval), std::chrono::microseconds(slack));
+        }
+    }
+    return 0;
+}
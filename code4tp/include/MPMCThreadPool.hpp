@@ -0,0 +1,237 @@
+#pragma once
+#include <rigtorp/MPMCQueue.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * SmallTask is a move-only type-erased void() callable.
+ * Callables up to kInlineSize bytes with a noexcept move constructor are stored inline,
+ * larger ones are moved to the heap. Moving a SmallTask never throws, as required by MPMCQueue.
+ * A default constructed SmallTask is empty.
+ */
+class SmallTask
+{
+public:
+    static constexpr std::size_t kInlineSize = 40;
+
+    SmallTask() noexcept = default;
+
+    template <class F, class = typename std::enable_if<
+                           !std::is_same<typename std::decay<F>::type, SmallTask>::value>::type>
+    SmallTask(F &&f)
+    {
+        using Callable = typename std::decay<F>::type;
+        construct<Callable>(std::forward<F>(f), std::integral_constant<bool, isInline<Callable>()>());
+    }
+
+    SmallTask(SmallTask &&other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    SmallTask &operator=(SmallTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    SmallTask(const SmallTask &) = delete;
+    SmallTask &operator=(const SmallTask &) = delete;
+
+    ~SmallTask() { reset(); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    void operator()() { ops_->invoke(&storage_); }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void *);
+        void (*move)(void *dst, void *src) noexcept;
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <class F>
+    static constexpr bool isInline()
+    {
+        return sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template <class F>
+    struct InlineOps
+    {
+        static void invoke(void *p) { (*static_cast<F *>(p))(); }
+        static void move(void *dst, void *src) noexcept
+        {
+            new (dst) F(std::move(*static_cast<F *>(src)));
+            static_cast<F *>(src)->~F();
+        }
+        static void destroy(void *p) noexcept { static_cast<F *>(p)->~F(); }
+        static const Ops ops;
+    };
+
+    template <class F>
+    struct HeapOps
+    {
+        static F *&get(void *p) { return *static_cast<F **>(p); }
+        static void invoke(void *p) { (*get(p))(); }
+        static void move(void *dst, void *src) noexcept { new (dst) F *(get(src)); }
+        static void destroy(void *p) noexcept { delete get(p); }
+        static const Ops ops;
+    };
+
+    template <class F, class Arg>
+    void construct(Arg &&f, std::true_type)
+    {
+        new (&storage_) F(std::forward<Arg>(f));
+        ops_ = &InlineOps<F>::ops;
+    }
+
+    template <class F, class Arg>
+    void construct(Arg &&f, std::false_type)
+    {
+        new (&storage_) F *(new F(std::forward<Arg>(f)));
+        ops_ = &HeapOps<F>::ops;
+    }
+
+    void moveFrom(SmallTask &other) noexcept
+    {
+        if (other.ops_)
+        {
+            other.ops_->move(&storage_, &other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type storage_;
+    const Ops *ops_ = nullptr;
+};
+
+template <class F>
+const SmallTask::Ops SmallTask::InlineOps<F>::ops = {&InlineOps<F>::invoke, &InlineOps<F>::move,
+                                                     &InlineOps<F>::destroy};
+
+template <class F>
+const SmallTask::Ops SmallTask::HeapOps<F>::ops = {&HeapOps<F>::invoke, &HeapOps<F>::move,
+                                                   &HeapOps<F>::destroy};
+
+/**
+ * MPMCThreadPool is a fixed-size thread pool whose run queue is a lock-free rigtorp::MPMCQueue.
+ * It has the same enqueue() API as ThreadPool.
+ * Idle workers park in MPMCQueue::try_pop_for() instead of spinning.
+ * Tasks still in the queue when the pool is destroyed are run before the workers exit.
+ */
+class MPMCThreadPool
+{
+public:
+    /**
+     * Construct a MPMCThreadPool.
+     *
+     * @param size Number of worker threads.
+     * @param capacity Capacity of the run queue. enqueue() blocks while the queue is full.
+     */
+    explicit MPMCThreadPool(size_t size, size_t capacity = 4096)
+        : _tasks(capacity)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            _workers.emplace_back([this] { workerMain(); });
+        }
+    }
+
+    ~MPMCThreadPool()
+    {
+        _run = false;
+        // One empty task per worker, queued after all pending tasks
+        for (size_t i = 0; i < _workers.size(); ++i)
+        {
+            push(SmallTask());
+        }
+        for (std::thread &worker : _workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+    MPMCThreadPool(const MPMCThreadPool &) = delete;
+    MPMCThreadPool &operator=(const MPMCThreadPool &) = delete;
+
+    /**
+     * Submit a task.
+     * Calling .get() on the returned future waits for the task and returns its result.
+     */
+    template <class F, class... Args>
+    auto enqueue(F &&f, Args &&...args) -> std::future<decltype(f(args...))>
+    {
+        using return_type = decltype(f(args...));
+
+        std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        std::future<return_type> res = task.get_future();
+
+        if (!_run)
+            throw std::runtime_error("ThreadPool is stopped.");
+
+        push(SmallTask(std::move(task)));
+        return res;
+    }
+
+    /** Number of idle threads */
+    int idlCount() { return _idlThrNum; }
+    /** Number of threads */
+    int thrCount() { return static_cast<int>(_workers.size()); }
+
+private:
+    void push(SmallTask &&task)
+    {
+        while (!_tasks.try_push_for(std::move(task), std::chrono::seconds(1)))
+            ;
+    }
+
+    void workerMain()
+    {
+        _idlThrNum++;
+        for (;;)
+        {
+            SmallTask task;
+            if (!_tasks.try_pop_for(task, std::chrono::seconds(1)))
+                continue;
+            if (!task) // stopped
+                break;
+            _idlThrNum--;
+            task();
+            _idlThrNum++;
+        }
+        _idlThrNum--;
+    }
+
+    rigtorp::MPMCQueue<SmallTask> _tasks;
+    std::vector<std::thread> _workers;
+    std::atomic<bool> _run{true};
+    std::atomic<int> _idlThrNum{0};
+};
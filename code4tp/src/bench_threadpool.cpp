@@ -0,0 +1,114 @@
+// Head-to-head benchmark of the thread pools in this repository:
+//   MPMCThreadPool  code4tp/include/MPMCThreadPool.hpp (lock-free run queue)
+//   ThreadPool      code4tp/include/ThreadPool.hpp
+//   zl::ThreadPool  c++/zl_threadpool-master/ThreadPoolCpp11/ThreadPool.h
+//   CThreadPool     queues/CThreadPool.h
+//
+// Usage: bench_threadpool [threads] [tasks] [latency samples]
+//
+// throughput: one producer submits empty tasks, time until all of them ran
+// latency:    time from submit to the start of the task, one task in flight
+
+// zl's header uses the same include guard as ThreadPool.hpp
+#include "../../c++/zl_threadpool-master/ThreadPoolCpp11/ThreadPool.h"
+#undef THREAD_POOL_H
+#include "../../queues/CThreadPool.h"
+#include "MPMCThreadPool.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+template <class Submit>
+void benchThroughput(const std::string &name, Submit submit, int tasks)
+{
+    std::atomic<int> done{0};
+    const auto start = Clock::now();
+    for (int i = 0; i < tasks; ++i)
+    {
+        submit([&done]
+               { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() != tasks)
+        std::this_thread::yield();
+    const auto secs = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << std::left << std::setw(16) << name << " throughput: " << std::setw(10)
+              << static_cast<long long>(tasks / secs) << " tasks/s" << std::endl;
+}
+
+template <class Submit>
+void benchLatency(const std::string &name, Submit submit, int samples)
+{
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    for (int i = 0; i < samples; ++i)
+    {
+        std::atomic<bool> ran{false};
+        Clock::time_point started;
+        const auto submitted = Clock::now();
+        submit([&]
+               {
+            started = Clock::now();
+            ran.store(true); });
+        while (!ran.load())
+            std::this_thread::yield();
+        latencies.push_back(std::chrono::duration<double, std::micro>(started - submitted).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::left << std::setw(16) << name << " latency:    p50 " << std::fixed
+              << std::setprecision(1) << latencies[samples / 2] << "us  p99 "
+              << latencies[samples * 99 / 100] << "us  max " << latencies.back() << "us"
+              << std::endl;
+}
+
+template <class Submit>
+void bench(const std::string &name, Submit submit, int tasks, int samples)
+{
+    benchThroughput(name, submit, tasks);
+    benchLatency(name, submit, samples);
+}
+
+int main(int argc, char *argv[])
+{
+    const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+    const int tasks = argc > 2 ? std::atoi(argv[2]) : 200000;
+    const int samples = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+    std::cout << threads << " threads, " << tasks << " tasks, " << samples << " latency samples"
+              << std::endl;
+    {
+        MPMCThreadPool pool(threads);
+        bench("MPMCThreadPool", [&](std::function<void()> f)
+              { pool.enqueue(std::move(f)); },
+              tasks, samples);
+    }
+    {
+        std::ThreadPool pool(threads);
+        bench("ThreadPool", [&](std::function<void()> f)
+              { pool.enqueue(std::move(f)); },
+              tasks, samples);
+    }
+    {
+        zl::ThreadPool pool(threads);
+        bench("zl::ThreadPool", [&](std::function<void()> f)
+              { pool.add(std::move(f)); },
+              tasks, samples);
+    }
+    {
+        CThreadPool pool;
+        pool.SetMaxCapacity(tasks);
+        pool.Start(threads);
+        bench("CThreadPool", [&](std::function<void()> f)
+              { pool.Commit(std::move(f)); },
+              tasks, samples);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "MPMCThreadPool.hpp"
+#include "Tester.hpp"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/////// 测试匿名函数 ///////
+void testMPMCThreadPool1()
+{
+    MPMCThreadPool pool(4);
+    auto result = pool.enqueue([](int answer)
+                               { return answer; },
+                               42);
+    TEST_EQUALS(result.get(), 42);
+    TEST_EQUALS(pool.thrCount(), 4);
+}
+
+/////// 测试大量任务 ///////
+void testMPMCThreadPool2()
+{
+    // Small run queue so that enqueue has to wait for free slots
+    MPMCThreadPool pool(4, 16);
+    std::atomic<int> sum{0};
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 10000; ++i)
+    {
+        results.emplace_back(pool.enqueue([&sum, i]
+                                          {
+            sum += i;
+            return i; }));
+    }
+    long long total = 0;
+    for (auto &&result : results)
+        total += result.get();
+    TEST_EQUALS(total, 10000LL * 9999 / 2);
+    TEST_EQUALS(sum.load(), 10000 * 9999 / 2);
+}
+
+/////// 测试只可移动的任务和超出内联缓冲区的任务 ///////
+void testMPMCThreadPool3()
+{
+    SmallTask empty;
+    TEST(!empty);
+
+    int called = 0;
+    std::unique_ptr<int> p(new int(7));
+    SmallTask moveOnly([&called, q = std::move(p)]
+                       { called += *q; });
+    SmallTask moved(std::move(moveOnly));
+    TEST(!moveOnly);
+    moved();
+    TEST_EQUALS(called, 7);
+
+    struct Large
+    {
+        char data[SmallTask::kInlineSize * 2];
+        int *called;
+        void operator()() { ++*called; }
+    };
+    SmallTask large(Large{{}, &called});
+    SmallTask assigned;
+    assigned = std::move(large);
+    assigned();
+    TEST_EQUALS(called, 8);
+
+    MPMCThreadPool pool(2);
+    auto res = pool.enqueue([](std::string a, std::string b)
+                            { return a + b; },
+                            std::string(64, 'a'), "b");
+    TEST_EQUALS(res.get(), std::string(64, 'a') + "b");
+}
+
+/////// 测试析构时执行完剩余任务 ///////
+void testMPMCThreadPool4()
+{
+    std::atomic<int> count{0};
+    {
+        MPMCThreadPool pool(2);
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.enqueue([&count]
+                         {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                count++; });
+        }
+    }
+    TEST_EQUALS(count.load(), 100);
+}
+
+int main()
+{
+    Tester tester("Test MPMCThreadPool");
+    tester.addTest(testMPMCThreadPool1, "Test MPMCTHREADPOOL eg.1");
+    tester.addTest(testMPMCThreadPool2, "Test MPMCTHREADPOOL eg.2");
+    tester.addTest(testMPMCThreadPool3, "Test MPMCTHREADPOOL eg.3");
+    tester.addTest(testMPMCThreadPool4, "Test MPMCTHREADPOOL eg.4");
+    tester.runTests();
+}
@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <execq/execq.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Usage: execq_queue_benchmark [items] [threads] [batch size]
+//
+// Pushes items with a trivial executor through each kind of queue and
+// measures items/sec from the first push until the last future is ready.
+// Each kind of queue is run once with batch size 1 and once with the given
+// batch size (QueueOptions::batchSize, BatchOptions::maxBatchSize).
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Queue = execq::IExecutionQueue<int(int)>;
+    
+    int Work(const std::atomic_bool&, int&& object)
+    {
+        return object;
+    }
+    
+    void WorkBatch(const std::atomic_bool&, std::vector<int>& objects, std::vector<std::promise<int>>& promises)
+    {
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            promises[i].set_value(objects[i]);
+        }
+    }
+    
+    void Run(const std::string& name, Queue& queue, const size_t items)
+    {
+        std::vector<std::future<int>> futures;
+        futures.reserve(items);
+        
+        const auto start = Clock::now();
+        for (size_t i = 0; i < items; i++)
+        {
+            futures.push_back(queue.push(static_cast<int>(i)));
+        }
+        for (auto& future : futures)
+        {
+            future.wait();
+        }
+        
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << name << static_cast<uint64_t>(items / seconds) << " items/s" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t items = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const uint32_t threadCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    const uint32_t batchSize = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 64;
+    
+    std::cout << items << " items, " << threadCount << " threads" << std::endl;
+    
+    const std::shared_ptr<execq::IExecutionPool> pool = execq::CreateExecutionPool(threadCount);
+    for (const uint32_t batch : { 1u, batchSize })
+    {
+        execq::QueueOptions options;
+        options.batchSize = batch;
+        
+        std::cout << "batch size " << batch << std::endl;
+        Run("  concurrent (pool):   ", *execq::CreateConcurrentExecutionQueue<int, int>(pool, &Work, options), items);
+        Run("  serial (pool):       ", *execq::CreateSerialExecutionQueue<int, int>(pool, &Work, options), items);
+        Run("  serial (own thread): ", *execq::CreateSerialExecutionQueue<int, int>(&Work, options), items);
+        
+        execq::BatchOptions batchOptions;
+        batchOptions.maxBatchSize = batch;
+        Run("  batch (pool):        ", *execq::CreateBatchExecutionQueue<int, int>(pool, &WorkBatch, batchOptions), items);
+    }
+    
+    return 0;
+}
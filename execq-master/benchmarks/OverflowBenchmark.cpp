@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <execq/execq.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage: execq_overflow_benchmark [queues] [threads]
+//
+// Occupies all pool threads with blocking tasks, then pushes one object to
+// each of 'queues' serial queues, so every queue falls back to its additional
+// worker. Reports process thread count and RSS once all objects are done,
+// for each OverflowPolicy.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Queue = execq::IExecutionQueue<int(int)>;
+    
+    std::string ProcessStatus(const std::string& field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, field.size(), field) == 0)
+            {
+                return line.substr(line.find_first_not_of(" \t", field.size() + 1));
+            }
+        }
+        
+        return "n/a";
+    }
+    
+    void Run(const std::string& name, const execq::PoolOptions& options, const size_t queueCount, const uint32_t threadCount)
+    {
+        auto pool = execq::CreateExecutionPool(threadCount, options);
+        
+        std::atomic_bool released { false };
+        std::atomic<uint32_t> blockedCount { 0 };
+        auto blockers = execq::CreateConcurrentExecutionQueue<void, int>(pool, [&] (const std::atomic_bool&, int) {
+            blockedCount++;
+            while (!released)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            blockers->push(0);
+        }
+        while (blockedCount < threadCount)
+        {
+            std::this_thread::yield();
+        }
+        
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::future<int>> futures;
+        queues.reserve(queueCount);
+        futures.reserve(queueCount);
+        
+        const auto start = Clock::now();
+        for (size_t i = 0; i < queueCount; i++)
+        {
+            queues.push_back(execq::CreateSerialExecutionQueue<int, int>(pool, [] (const std::atomic_bool&, int&& object) {
+                return object;
+            }));
+            futures.push_back(queues.back()->push(static_cast<int>(i)));
+        }
+        // Each busy pool thread accepts one notification and serves it only when released
+        for (size_t i = threadCount; i < futures.size(); i++)
+        {
+            futures[i].wait();
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        
+        std::cout << name << "threads " << ProcessStatus("Threads:") << ", RSS " << ProcessStatus("VmRSS:")
+                  << ", " << static_cast<uint64_t>(queueCount / seconds) << " queues/s" << std::endl;
+        
+        released = true;
+        for (auto& future : futures)
+        {
+            future.wait();
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t queueCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const uint32_t threadCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    
+    std::cout << queueCount << " queues, " << threadCount << " pool threads" << std::endl;
+    
+    execq::PoolOptions dedicated;
+    dedicated.overflowPolicy = execq::OverflowPolicy::DedicatedThread;
+    Run("dedicated threads        : ", dedicated, queueCount, threadCount);
+    
+    execq::PoolOptions shared;
+    shared.overflowPolicy = execq::OverflowPolicy::SharedThreads;
+    Run("shared threads, limit " + std::to_string(threadCount) + " : ", shared, queueCount, threadCount);
+    
+    shared.maxOverflowThreads = 4 * threadCount;
+    Run("shared threads, limit " + std::to_string(4 * threadCount) + " : ", shared, queueCount, threadCount);
+    
+    return 0;
+}
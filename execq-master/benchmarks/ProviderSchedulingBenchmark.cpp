@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <execq/execq.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Usage: execq_providers_benchmark [queues] [threads] [tasks]
+//
+// Registers many queues on one pool and measures how fast the pool threads
+// pick tasks from them:
+//   all busy:   tasks are spread round-robin over all queues
+//   one busy:   all tasks go to the last registered queue, every other queue is empty
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Queue = execq::IExecutionQueue<void(int)>;
+    
+    void Work(const std::atomic_bool&, int&&)
+    {}
+    
+    double Run(std::vector<std::unique_ptr<Queue>>& queues, const size_t tasks, const bool allBusy)
+    {
+        std::vector<std::future<void>> futures;
+        futures.reserve(tasks);
+        
+        const auto start = Clock::now();
+        for (size_t i = 0; i < tasks; i++)
+        {
+            Queue& queue = allBusy ? *queues[i % queues.size()] : *queues.back();
+            futures.push_back(queue.push(static_cast<int>(i)));
+        }
+        for (auto& future : futures)
+        {
+            future.wait();
+        }
+        
+        return tasks / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t queueCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const uint32_t threadCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 8;
+    const size_t tasks = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+    
+    std::cout << queueCount << " queues, " << threadCount << " threads, " << tasks << " tasks" << std::endl;
+    
+    const std::shared_ptr<execq::IExecutionPool> pool = execq::CreateExecutionPool(threadCount);
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (size_t i = 0; i < queueCount; i++)
+    {
+        queues.push_back(execq::CreateConcurrentExecutionQueue<void, int>(pool, &Work));
+    }
+    
+    std::cout << "all busy: " << static_cast<uint64_t>(Run(queues, tasks, true)) << " tasks/s" << std::endl;
+    std::cout << "one busy: " << static_cast<uint64_t>(Run(queues, tasks, false)) << " tasks/s" << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <execq/execq.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Usage: execq_stream_concurrency_benchmark [pool threads] [device capacity] [seconds]
+//
+// Runs a stream against a simulated device that serves 'capacity' requests
+// at once, 1 ms each; other requests wait in the device queue. Reports tasks/sec,
+// average task latency and average number of running tasks for unlimited,
+// fixed and adaptive stream concurrency.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    
+    class Device
+    {
+    public:
+        explicit Device(const uint32_t capacity)
+        : m_free(capacity)
+        {}
+        
+        void request()
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                while (!m_free)
+                {
+                    m_condition.wait(lock);
+                }
+                m_free--;
+            }
+            
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free++;
+            m_condition.notify_one();
+        }
+        
+    private:
+        uint32_t m_free = 0;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+    };
+    
+    void Run(const std::string& name, const execq::StreamOptions& options, const uint32_t threadCount, const uint32_t capacity, const int seconds)
+    {
+        auto pool = execq::CreateExecutionPool(threadCount);
+        Device device(capacity);
+        
+        std::atomic<uint64_t> taskCount { 0 };
+        std::atomic<uint64_t> latencySum { 0 };
+        std::atomic<uint64_t> runningSum { 0 };
+        std::atomic<uint32_t> running { 0 };
+        auto stream = execq::CreateExecutionStream(pool, [&] (const std::atomic_bool&) {
+            runningSum += ++running;
+            const auto start = Clock::now();
+            device.request();
+            latencySum += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            taskCount++;
+            running--;
+        }, options);
+        
+        stream->start();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stream->stop();
+        
+        const uint64_t tasks = taskCount;
+        std::cout << name << tasks / seconds << " tasks/s, latency " << latencySum / tasks << " us, "
+                  << static_cast<double>(runningSum) / tasks << " running" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const uint32_t threadCount = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 32;
+    const uint32_t capacity = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 3;
+    
+    std::cout << threadCount << " pool threads, device capacity " << capacity << std::endl;
+    
+    execq::StreamOptions options;
+    Run("unlimited : ", options, threadCount, capacity, seconds);
+    
+    options.maxConcurrency = capacity;
+    Run("fixed     : ", options, threadCount, capacity, seconds);
+    
+    options.maxConcurrency = 0;
+    options.adaptiveConcurrency = true;
+    Run("adaptive  : ", options, threadCount, capacity, seconds);
+    
+    return 0;
+}
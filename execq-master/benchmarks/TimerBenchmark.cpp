@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <execq/execq.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Usage: execq_timer_benchmark [timer count] [max delay ms]
+//
+// Pushes 'count' objects with random delays up to 'max delay' into a concurrent queue
+// and reports memory taken by pending timers and how late the objects were processed.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    
+    long MaxResidentKb()
+    {
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const uint32_t count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+    const int maxDelayMs = argc > 2 ? std::atoi(argv[2]) : 3000;
+    
+    auto pool = execq::CreateExecutionPool();
+    
+    std::mutex mutex;
+    std::vector<int64_t> lateness;
+    lateness.reserve(count);
+    auto queue = execq::CreateConcurrentExecutionQueue<void, Clock::time_point>(pool, [&] (const std::atomic_bool&, Clock::time_point&& dueTime) {
+        const int64_t late = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - dueTime).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        lateness.push_back(late);
+    });
+    
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> delays(1000, maxDelayMs * 1000);
+    
+    const long residentBefore = MaxResidentKb();
+    const auto pushStart = Clock::now();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto dueTime = Clock::now() + std::chrono::microseconds(delays(random));
+        queue->pushAt(dueTime, dueTime);
+    }
+    const auto pushTime = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - pushStart).count();
+    const long residentPending = MaxResidentKb() - residentBefore;
+    
+    // Destroying the queue would fire pending timers at once
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (lateness.size() == count)
+        {
+            break;
+        }
+    }
+    queue.reset();
+    
+    std::sort(lateness.begin(), lateness.end());
+    int64_t sum = 0;
+    for (const int64_t late : lateness)
+    {
+        sum += late;
+    }
+    
+    std::cout << count << " timers pushed in " << pushTime << " ms, pending memory " << residentPending * 1024 / count << " bytes/timer" << std::endl;
+    std::cout << "lateness: avg " << sum / count << " us, p50 " << lateness[count / 2] << " us, p99 " << lateness[count * 99 / 100]
+              << " us, max " << lateness.back() << " us" << std::endl;
+    
+    return 0;
+}
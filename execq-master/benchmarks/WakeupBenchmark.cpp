@@ -0,0 +1,104 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <execq/execq.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Usage: execq_wakeup_benchmark [samples]
+//
+// Measures the latency from IExecutionQueue::push until the executor starts:
+//   idle pool:         every pool thread is parked
+//   all but one busy:  all pool threads except one run back-to-back 2ms tasks
+// Runs with 4, 16 and 64 pool threads.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    
+    void Measure(const uint32_t threadCount, const size_t samples, const bool busy)
+    {
+        const std::shared_ptr<execq::IExecutionPool> pool = execq::CreateExecutionPool(threadCount);
+        auto queue = execq::CreateConcurrentExecutionQueue<Clock::time_point, Clock::time_point>(pool, [] (const std::atomic_bool&, Clock::time_point&&) {
+            return Clock::now();
+        });
+        
+        // Each blocker occupies a pool thread with 2ms tasks until the measurement is done
+        std::atomic_bool stop { false };
+        execq::IExecutionQueue<void(int)>* blockersQueue = nullptr;
+        auto blockers = execq::CreateConcurrentExecutionQueue<void, int>(pool, [&] (const std::atomic_bool&, int&&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            if (!stop)
+            {
+                blockersQueue->push(0);
+            }
+        });
+        blockersQueue = blockers.get();
+        if (busy)
+        {
+            for (uint32_t i = 0; i + 1 < threadCount; i++)
+            {
+                blockers->push(0);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        
+        std::vector<double> latencies;
+        latencies.reserve(samples);
+        for (size_t i = 0; i < samples; i++)
+        {
+            // Let the worker park again before the next sample
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            
+            const Clock::time_point pushed = Clock::now();
+            const Clock::time_point started = queue->push(pushed).get();
+            latencies.push_back(std::chrono::duration<double, std::micro>(started - pushed).count());
+        }
+        stop = true;
+        blockers.reset();
+        
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::setw(3) << threadCount << " threads, " << (busy ? "all but one busy" : "idle pool       ")
+                  << ": p50 " << std::fixed << std::setprecision(1) << latencies[samples / 2]
+                  << "us  p99 " << latencies[samples * 99 / 100] << "us" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    
+    for (const uint32_t threadCount : { 4u, 16u, 64u })
+    {
+        Measure(threadCount, samples, false);
+        Measure(threadCount, samples, true);
+    }
+    
+    return 0;
+}
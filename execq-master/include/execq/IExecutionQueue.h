@@ -24,11 +24,75 @@
 
 #pragma once
 
+#include "execq/SchedulingOptions.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <future>
+#include <vector>
 
 namespace execq
 {
+    /**
+     * @struct QueueOptions
+     * @brief Tuning options of IExecutionQueue.
+     */
+    struct QueueOptions
+    {
+        /**
+         * @brief Maximum number of objects a worker processes in a row before it returns to the pool.
+         * @discussion Larger batches amortize scheduling overhead for high-rate queues at the cost of latency of other queues in the pool.
+         * Default value 1 processes objects one by one. Zero is treated as 1.
+         */
+        uint32_t batchSize = 1;
+        
+        /**
+         * @brief Maximum time a worker keeps processing one batch. Zero means only 'batchSize' limits the batch.
+         * @discussion The object being processed is never interrupted: the limit is checked between objects.
+         */
+        std::chrono::microseconds batchDuration { 0 };
+        
+        /**
+         * @brief Priority and weight of the queue in the pool, see SchedulingOptions.
+         */
+        SchedulingOptions scheduling;
+    };
+    
+    /**
+     * @struct BatchOptions
+     * @brief Coalescing options of batch queues, see CreateBatchExecutionQueue.
+     */
+    struct BatchOptions
+    {
+        /**
+         * @brief Maximum number of objects passed to one executor call. Zero is treated as 1.
+         */
+        uint32_t maxBatchSize = 64;
+        
+        /**
+         * @brief How long a batch waits for more objects after its first object was pushed.
+         * @discussion Zero means the batch takes whatever objects are pending and does not wait.
+         * While waiting, the batch occupies one thread of the pool.
+         */
+        std::chrono::microseconds maxDelay { 0 };
+        
+        /**
+         * @brief Priority and weight of the queue in the pool, see SchedulingOptions.
+         */
+        SchedulingOptions scheduling;
+    };
+    
+    /**
+     * @brief Executor of batch queues.
+     * @discussion 'objects' and 'promises' have the same size; the executor must satisfy promises[i] with the result of objects[i].
+     * If the executor throws, the exception is set to all promises that are not satisfied yet.
+     */
+    template <typename R, typename T>
+    using BatchExecutor = std::function<void(const std::atomic_bool& isCanceled, std::vector<T>& objects, std::vector<std::promise<R>>& promises)>;
+    
     template <typename Unused>
     class IExecutionQueue;
     
@@ -66,32 +130,82 @@ namespace execq
         template <typename... Args>
         std::future<R> emplace(Args&&... args);
         
+        /**
+         * @brief Pushes an object to be processed on the queue not earlier than after 'delay'.
+         * @discussion Until due, the object is held by the timer wheel of the pool and occupies no thread.
+         * Objects pushed before 'cancel' call are canceled even if not due yet; they are still processed on their time.
+         * When the queue is destroyed, pending objects are processed immediately as canceled.
+         * @return Future object to obtain result when the task is done.
+         */
+        std::future<R> pushAfter(const std::chrono::steady_clock::duration delay, const T& object);
+        std::future<R> pushAfter(const std::chrono::steady_clock::duration delay, T&& object);
+        
+        /**
+         * @brief Pushes an object to be processed on the queue not earlier than at 'time'.
+         * @discussion Same as pushAfter.
+         * @return Future object to obtain result when the task is done.
+         */
+        std::future<R> pushAt(const std::chrono::steady_clock::time_point time, const T& object);
+        std::future<R> pushAt(const std::chrono::steady_clock::time_point time, T&& object);
+        
         /**
          * @brief Makrs all tasks as canceled.
          * @discussion Be aware that new tasks added after 'cancel' call will not be marked as 'canceled'.
          */
         virtual void cancel() = 0;
         
+        /**
+         * @brief Number of tasks pool threads have taken from the queue.
+         * @discussion With batching, one task processes up to 'batchSize' objects. Tasks run on the queue-specific thread are not counted.
+         * Useful to check how the pool shares threads between queues with different SchedulingOptions.
+         */
+        virtual uint64_t servedTaskCount() const = 0;
+        
     private:
-        virtual std::future<R> pushImpl(std::unique_ptr<T> object) = 0;
+        virtual std::future<R> pushImpl(T&& object) = 0;
+        virtual std::future<R> pushAtImpl(const std::chrono::steady_clock::time_point time, T&& object) = 0;
     };
 }
 
 template <typename T, typename R>
 std::future<R> execq::IExecutionQueue<R(T)>::push(const T& object)
 {
-    return pushImpl(std::unique_ptr<T>(new T { object }));
+    return pushImpl(T { object });
 }
 
 template <typename T, typename R>
 std::future<R> execq::IExecutionQueue<R(T)>::push(T&& object)
 {
-    return pushImpl(std::unique_ptr<T>(new T { std::move(object) }));
+    return pushImpl(std::move(object));
 }
 
 template <typename T, typename R>
 template <typename... Args>
 std::future<R> execq::IExecutionQueue<R(T)>::emplace(Args&&... args)
 {
-    return pushImpl(std::unique_ptr<T>(new T { std::forward<Args>(args)... }));
+    return pushImpl(T { std::forward<Args>(args)... });
+}
+
+template <typename T, typename R>
+std::future<R> execq::IExecutionQueue<R(T)>::pushAfter(const std::chrono::steady_clock::duration delay, const T& object)
+{
+    return pushAtImpl(std::chrono::steady_clock::now() + delay, T { object });
+}
+
+template <typename T, typename R>
+std::future<R> execq::IExecutionQueue<R(T)>::pushAfter(const std::chrono::steady_clock::duration delay, T&& object)
+{
+    return pushAtImpl(std::chrono::steady_clock::now() + delay, std::move(object));
+}
+
+template <typename T, typename R>
+std::future<R> execq::IExecutionQueue<R(T)>::pushAt(const std::chrono::steady_clock::time_point time, const T& object)
+{
+    return pushAtImpl(time, T { object });
+}
+
+template <typename T, typename R>
+std::future<R> execq::IExecutionQueue<R(T)>::pushAt(const std::chrono::steady_clock::time_point time, T&& object)
+{
+    return pushAtImpl(time, std::move(object));
 }
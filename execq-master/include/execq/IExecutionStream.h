@@ -24,10 +24,38 @@
 
 #pragma once
 
+#include "execq/SchedulingOptions.h"
+
+#include <cstdint>
 #include <memory>
 
 namespace execq
 {
+    /**
+     * @struct StreamOptions
+     * @brief Tuning options of IExecutionStream.
+     */
+    struct StreamOptions
+    {
+        /**
+         * @brief Priority and weight of the stream in the pool, see SchedulingOptions.
+         */
+        SchedulingOptions scheduling;
+        
+        /**
+         * @brief Maximum number of the stream's tasks running at the same time. Zero means no limit.
+         * @discussion Keeps streams like filesystem traversal from taking all pool threads or oversubscribing I/O.
+         */
+        uint32_t maxConcurrency = 0;
+        
+        /**
+         * @brief Adjusts the number of running tasks from measured task latency, up to 'maxConcurrency' (256 if it is zero).
+         * @discussion The stream starts with few tasks and adds more while latency stays close to the lowest seen.
+         * When latency grows because tasks wait for a shared resource (disk, network), the stream runs fewer tasks.
+         */
+        bool adaptiveConcurrency = false;
+    };
+    
     /**
      * @class IExecutionStream
      * @brief High-level interface that provides access to stream-based tasks execution.
@@ -56,5 +84,11 @@ namespace execq
          * All tasks being executed during stop will normally continue.
          */
         virtual void stop() = 0;
+        
+        /**
+         * @brief Number of tasks pool threads have taken from the stream.
+         * @discussion Tasks run on the stream-specific thread are not counted.
+         */
+        virtual uint64_t servedTaskCount() const = 0;
     };
 }
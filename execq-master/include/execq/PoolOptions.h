@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace execq
+{
+    /**
+     * @brief Where queues and streams of the pool run their tasks when all pool threads are busy.
+     */
+    enum class OverflowPolicy
+    {
+        /**
+         * @brief Each queue and stream has its own additional thread, started on first use.
+         */
+        DedicatedThread,
+        
+        /**
+         * @brief All queues and streams of the pool share one group of additional threads, created on demand.
+         * @discussion The group is limited by PoolOptions::maxOverflowThreads.
+         * Shared threads are not retired when idle: they stay parked until the pool is destroyed.
+         */
+        SharedThreads,
+    };
+    
+    /**
+     * @struct PoolOptions
+     * @brief Tuning options of IExecutionPool.
+     */
+    struct PoolOptions
+    {
+        OverflowPolicy overflowPolicy = OverflowPolicy::SharedThreads;
+        
+        /**
+         * @brief Maximum number of shared additional threads. Zero means the pool's thread count. Ignored for DedicatedThread policy.
+         * @discussion Queues waiting for additional threads are served in turn, one task at a time.
+         * If tasks of the pool may block for a long time waiting for each other, raise the limit or use DedicatedThread policy.
+         * @discussion Created threads live as long as the pool, so the group keeps its peak size (at most the limit) after a burst.
+         */
+        uint32_t maxOverflowThreads = 0;
+    };
+}
@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace execq
+{
+    /**
+     * @brief Priority class of a queue or stream in the pool.
+     */
+    enum class Priority
+    {
+        Normal,
+        
+        /**
+         * @brief Served by pool threads strictly before all Normal queues and streams.
+         * @discussion Intended for latency-critical providers with moderate load: a saturated High provider starves the Normal ones.
+         */
+        High,
+    };
+    
+    /**
+     * @struct SchedulingOptions
+     * @brief How pool threads share time between a queue or stream and other providers of the pool.
+     */
+    struct SchedulingOptions
+    {
+        Priority priority = Priority::Normal;
+        
+        /**
+         * @brief Relative share of pool threads among providers of the same priority. Zero is treated as 1.
+         * @discussion Providers are served by deficit round robin: in each turn a provider with weight N gets up to N tasks in a row.
+         */
+        uint32_t weight = 1;
+    };
+}
@@ -26,6 +26,7 @@
 
 #include "IExecutionQueue.h"
 #include "IExecutionStream.h"
+#include "PoolOptions.h"
 
 #include <atomic>
 #include <memory>
@@ -42,15 +43,17 @@ namespace execq
     /**
      * @brief Creates pool with hardware-optimal number of threads.
      * @discussion Usually you want to create single instance of IExecutionPool for multiple IExecutionQueue/IExecutionStream to achive best performance.
+     * @param options Options of the pool, see PoolOptions.
      */
-    std::shared_ptr<IExecutionPool> CreateExecutionPool();
+    std::shared_ptr<IExecutionPool> CreateExecutionPool(const PoolOptions& options = PoolOptions());
     
     /**
      * @brief Creates pool with manually-specified number of threads.
      * @discussion Sometimes number of threads should be restricted or can be detected in some non-default way.
      * @param threadCount Number of threads for execution context. If number of threads less than 2, exeption will be raised.
+     * @param options Options of the pool, see PoolOptions.
      */
-    std::shared_ptr<IExecutionPool> CreateExecutionPool(const uint32_t threadCount);
+    std::shared_ptr<IExecutionPool> CreateExecutionPool(const uint32_t threadCount, const PoolOptions& options = PoolOptions());
 
     
     
@@ -60,10 +63,12 @@ namespace execq
      * @discussion Tasks in the queue run concurrently on available threads.
      * @discussion Queue is not designed to execute long-term tasks like waiting some event etc.
      * For such purposes use separate thread or serial queue without execution pool.
+     * @param options Batching and scheduling options of the queue, see QueueOptions.
      */
     template <typename R, typename T>
     std::unique_ptr<IExecutionQueue<R(T)>> CreateConcurrentExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
-                                                                          std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor);
+                                                                          std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                                                                          const QueueOptions& options = QueueOptions());
     
     /**
      * @brief Creates serial queue with specific processing function.
@@ -71,19 +76,23 @@ namespace execq
      * @discussion Tasks in the queue run in serial (one-after-one) order.
      * @discussion Queue is not designed to execute long-term tasks like waiting some event etc.
      * For such purposes use separate thread or serial queue without execution pool.
+     * @param options Batching and scheduling options of the queue, see QueueOptions.
      */
     template <typename R, typename T>
     std::unique_ptr<IExecutionQueue<R(T)>> CreateSerialExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
-                                                                      std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor);
+                                                                      std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                                                                      const QueueOptions& options = QueueOptions());
     
     /**
      * @brief Creates serial queue with specific processing function.
      * @discussion All objects pushed into this queue will be processed on the queue-specific thread.
      * @discussion Tasks in the queue run in serial (one-after-one) order.
      * @discussion This queue can be used to execute long-term tasks like waiting some event etc.
+     * @param options Batching and scheduling options of the queue, see QueueOptions.
      */
     template <typename R, typename T>
-    std::unique_ptr<IExecutionQueue<R(T)>> CreateSerialExecutionQueue(std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor);
+    std::unique_ptr<IExecutionQueue<R(T)>> CreateSerialExecutionQueue(std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                                                                      const QueueOptions& options = QueueOptions());
     
     
     /**
@@ -91,9 +100,34 @@ namespace execq
      * @discussion When stream started, 'executee' function will be called each time when ExecutionPool have free thread.
      * @discussion Stream is not designed to execute long-term tasks like waiting some event etc.
      * For such purposes use separate thread or serial queue without execution pool.
+     * @param options Options of the stream, see StreamOptions.
      */
     std::unique_ptr<IExecutionStream> CreateExecutionStream(std::shared_ptr<IExecutionPool> executionPool,
-                                                            std::function<void(const std::atomic_bool& isCanceled)> executee);
+                                                            std::function<void(const std::atomic_bool& isCanceled)> executee,
+                                                            const StreamOptions& options = StreamOptions());
+    
+    
+    
+    /**
+     * @brief Creates serial queue that processes objects in batches.
+     * @discussion Pending objects are coalesced and passed to 'executor' together, up to 'options.maxBatchSize' objects per call.
+     * If 'options.maxDelay' is set, a batch waits for more objects up to that time after its first object was pushed.
+     * @discussion Batches run in serial (one-after-one) order on either one of pool threads or on the queue-specific thread.
+     * @param options Coalescing and scheduling options of the queue, see BatchOptions.
+     */
+    template <typename R, typename T>
+    std::unique_ptr<IExecutionQueue<R(T)>> CreateBatchExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                                     BatchExecutor<R, T> executor,
+                                                                     const BatchOptions& options = BatchOptions());
+    
+    /**
+     * @brief Creates serial queue that processes objects in batches.
+     * @discussion Same as pool-based batch queue, but all batches are processed on the queue-specific thread.
+     * @param options Coalescing and scheduling options of the queue, see BatchOptions.
+     */
+    template <typename R, typename T>
+    std::unique_ptr<IExecutionQueue<R(T)>> CreateBatchExecutionQueue(BatchExecutor<R, T> executor,
+                                                                     const BatchOptions& options = BatchOptions());
     
     
     
@@ -106,9 +140,11 @@ namespace execq
      * @discussion Tasks in the queue run concurrently on available threads.
      * @discussion Queue is not designed to execute long-term tasks like waiting some event etc.
      * For such purposes use separate thread or serial queue without execution pool.
+     * @param options Batching and scheduling options of the queue, see QueueOptions.
      */
     template <typename R = void>
-    std::unique_ptr<IExecutionQueue<void(QueueTask<R>)>> CreateConcurrentTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool);
+    std::unique_ptr<IExecutionQueue<void(QueueTask<R>)>> CreateConcurrentTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                                                            const QueueOptions& options = QueueOptions());
     
     /**
      * @brief Creates serial queue that processes custom tasks.
@@ -116,18 +152,21 @@ namespace execq
      * @discussion Tasks in the queue run in serial (one-after-one) order.
      * @discussion Queue is not designed to execute long-term tasks like waiting some event etc.
      * For such purposes use separate thread or serial queue without execution pool.
+     * @param options Batching and scheduling options of the queue, see QueueOptions.
      */
     template <typename R = void>
-    std::unique_ptr<IExecutionQueue<void(QueueTask<R>)>> CreateSerialTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool);
+    std::unique_ptr<IExecutionQueue<void(QueueTask<R>)>> CreateSerialTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                                                        const QueueOptions& options = QueueOptions());
     
     /**
      * @brief Creates serial queue that processes custom tasks.
      * @discussion All objects pushed into this queue will be processed on the queue-specific thread.
      * @discussion Tasks in the queue run in serial (one-after-one) order.
      * @discussion This queue can be used to execute long-term tasks like waiting some event etc.
+     * @param options Batching and scheduling options of the queue, see QueueOptions.
      */
     template <typename R = void>
-    std::unique_ptr<IExecutionQueue<void(QueueTask<R>)>> CreateSerialTaskExecutionQueue();
+    std::unique_ptr<IExecutionQueue<void(QueueTask<R>)>> CreateSerialTaskExecutionQueue(const QueueOptions& options = QueueOptions());
     
 }
 
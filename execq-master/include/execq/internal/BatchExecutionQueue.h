@@ -0,0 +1,233 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "execq/internal/QueueBase.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace execq
+{
+    namespace impl
+    {
+        template <typename R, typename T>
+        struct BatchedObject
+        {
+            T object;
+            std::promise<R> promise;
+            CancelToken cancelToken;
+            std::chrono::steady_clock::time_point pushTime;
+        };
+        
+        /**
+         * @brief Serial queue that passes pending objects to the executor in batches.
+         * @discussion One batch is in flight at a time; objects pushed meanwhile are coalesced into the next one.
+         * A batch never mixes objects pushed before and after cancel(), so it has a single 'isCanceled' flag.
+         */
+        template <typename R, typename T>
+        class BatchExecutionQueue: public QueueBase<BatchExecutionQueue<R, T>, R, T, BatchedObject<R, T>>
+        {
+            using Base = QueueBase<BatchExecutionQueue<R, T>, R, T, BatchedObject<R, T>>;
+            
+        public:
+            BatchExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                const IThreadWorkerFactory& workerFactory,
+                                BatchExecutor<R, T> executor,
+                                const BatchOptions& options = BatchOptions());
+            ~BatchExecutionQueue();
+            
+        private: // IThreadWorkerPoolTaskProvider
+            virtual Task nextTask() final;
+            
+        private:
+            friend Base;
+            void enqueue(T&& object, std::promise<R>&& promise, const CancelToken cancelToken);
+            
+            void executeBatch();
+            
+        private:
+            using Base::m_taskRunningCount;
+            using Base::m_hasTask;
+            using Base::m_taskQueue;
+            using Base::m_taskQueueMutex;
+            using Base::m_taskQueueCondition;
+            using Base::m_cancelTokenProvider;
+            using Base::notifyWorkers;
+            using Base::renotifyWorkers;
+            
+            bool m_flush = false;
+            std::condition_variable m_batchCondition;
+            
+            // Only the batch in flight uses them, kept to reuse their memory
+            std::vector<T> m_batchObjects;
+            std::vector<std::promise<R>> m_batchPromises;
+            
+            const uint32_t m_maxBatchSize = 1;
+            const std::chrono::microseconds m_maxDelay;
+            const BatchExecutor<R, T> m_executor;
+        };
+    }
+}
+
+template <typename R, typename T>
+execq::impl::BatchExecutionQueue<R, T>::BatchExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                            const IThreadWorkerFactory& workerFactory,
+                                                            BatchExecutor<R, T> executor,
+                                                            const BatchOptions& options)
+: Base(std::move(executionPool), workerFactory, options.scheduling)
+, m_maxBatchSize(std::max<uint32_t>(options.maxBatchSize, 1))
+, m_maxDelay(options.maxDelay)
+, m_executor(std::move(executor))
+{
+    m_batchObjects.reserve(m_maxBatchSize);
+    m_batchPromises.reserve(m_maxBatchSize);
+    
+    Base::attachToPool();
+}
+
+template <typename R, typename T>
+execq::impl::BatchExecutionQueue<R, T>::~BatchExecutionQueue()
+{
+    Base::shutdown([this] {
+        // Don't let the batch in flight wait for more objects
+        std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+        m_flush = true;
+        m_batchCondition.notify_all();
+    });
+}
+
+// IThreadWorkerPoolTaskProvider
+
+template <typename R, typename T>
+execq::impl::Task execq::impl::BatchExecutionQueue<R, T>::nextTask()
+{
+    if (!m_hasTask)
+    {
+        return Task();
+    }
+    
+    // Batch buffers are shared, so exactly one worker may win the queue
+    size_t running = 0;
+    if (!m_taskRunningCount.compare_exchange_strong(running, 1))
+    {
+        return Task();
+    }
+    
+    return Task([this] {
+        executeBatch();
+        
+        m_taskRunningCount--;
+        if (!m_hasTask)
+        {
+            std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+            m_taskQueueCondition.notify_all();
+        }
+        else
+        {
+            renotifyWorkers();
+        }
+    });
+}
+
+// Private
+
+template <typename R, typename T>
+void execq::impl::BatchExecutionQueue<R, T>::enqueue(T&& object, std::promise<R>&& promise, const CancelToken cancelToken)
+{
+    const auto pushTime = m_maxDelay.count() > 0 ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    
+    bool alreadyHasTask = false;
+    {
+        std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+        
+        alreadyHasTask = m_hasTask;
+        m_hasTask = true;
+        m_taskQueue.emplace(std::move(object), std::move(promise), cancelToken, pushTime);
+        if (m_taskQueue.size() >= m_maxBatchSize)
+        {
+            m_batchCondition.notify_one();
+        }
+    }
+    
+    if (!alreadyHasTask)
+    {
+        notifyWorkers();
+    }
+}
+
+template <typename R, typename T>
+void execq::impl::BatchExecutionQueue<R, T>::executeBatch()
+{
+    CancelToken cancelToken = 0;
+    {
+        std::unique_lock<std::mutex> lock(m_taskQueueMutex);
+        if (m_taskQueue.empty())
+        {
+            return;
+        }
+        
+        if (m_maxDelay.count() > 0)
+        {
+            const auto deadline = m_taskQueue.front().pushTime + m_maxDelay;
+            m_batchCondition.wait_until(lock, deadline, [this] {
+                return m_flush || m_taskQueue.size() >= m_maxBatchSize;
+            });
+        }
+        
+        cancelToken = m_taskQueue.front().cancelToken;
+        while (!m_taskQueue.empty() && m_batchObjects.size() < m_maxBatchSize && m_taskQueue.front().cancelToken == cancelToken)
+        {
+            BatchedObject<R, T>& object = m_taskQueue.front();
+            m_batchObjects.push_back(std::move(object.object));
+            m_batchPromises.push_back(std::move(object.promise));
+            m_taskQueue.pop();
+        }
+        m_hasTask = !m_taskQueue.empty();
+    }
+    
+    try
+    {
+        const CancelFlag canceled(m_cancelTokenProvider, cancelToken);
+        m_executor(canceled.get(), m_batchObjects, m_batchPromises);
+    }
+    catch (...)
+    {
+        for (std::promise<R>& promise : m_batchPromises)
+        {
+            try
+            {
+                promise.set_exception(std::current_exception());
+            }
+            catch (const std::future_error&)
+            {
+                // Already satisfied by the executor
+            }
+        }
+    }
+    
+    m_batchObjects.clear();
+    m_batchPromises.clear();
+}
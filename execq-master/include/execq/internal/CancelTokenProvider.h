@@ -25,27 +25,89 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 namespace execq
 {
     namespace impl
     {
-        using CancelToken = std::shared_ptr<std::atomic_bool>;
+        /**
+         * @brief Cancel epoch of the object: generation it was pushed in and the flag slot of that generation.
+         * @discussion Objects pushed between two cancelAndRenew() calls have equal tokens.
+         */
+        using CancelToken = uint64_t;
+        
+        /**
+         * @brief Lock-free source of cancel tokens.
+         * @discussion Taking a token is a single atomic load. Each generation owns one of few 'isCanceled' flags,
+         * the flag is reused for a newer generation once all tasks of the older one are done.
+         * If tasks of all older generations are still running, one slot gets a new flag and the old one is freed later:
+         * cancelAndRenew() never waits for running tasks, so executors may call it themselves.
+         */
         class CancelTokenProvider
         {
         public:
-            CancelToken token();
+            CancelTokenProvider();
+            
+            CancelToken token() const;
+            bool isCanceled(const CancelToken token) const;
+            
+            /**
+             * @brief Cancels current generation: objects pushed before and after the call are canceled.
+             */
             void cancel();
+            
+            /**
+             * @brief Cancels current generation and starts a new one: only objects pushed before the call are canceled.
+             */
             void cancelAndRenew();
             
         private:
-            void cancelAndRenew(const bool renew);
+            friend class CancelFlag;
+            
+            struct FlagSlot
+            {
+                std::atomic<uint64_t> generation;
+                std::atomic<uint32_t> useCount;
+                std::atomic<std::atomic_bool*> canceled;
+                
+                // Guarded by m_mutex: the current flag is the last one, older ones may still be used by running tasks
+                std::vector<std::unique_ptr<std::atomic_bool>> flags;
+            };
+            
+            static const uint32_t kSlotCount = 8;
+            
+            bool tryReserveSlot(FlagSlot& slot);
+            void replaceFlag(FlagSlot& slot);
+            void releaseOldFlags();
             
         private:
-            CancelToken m_currentToken = std::make_shared<std::atomic_bool>(false);
+            std::atomic<CancelToken> m_currentToken;
+            mutable FlagSlot m_slots[kSlotCount];
             std::mutex m_mutex;
         };
+        
+        /**
+         * @brief 'isCanceled' flag of the token for executors, valid while CancelFlag is alive.
+         * @discussion Follows cancel() and cancelAndRenew() made during execution.
+         */
+        class CancelFlag
+        {
+        public:
+            CancelFlag(const CancelTokenProvider& provider, const CancelToken token);
+            ~CancelFlag();
+            
+            CancelFlag(const CancelFlag&) = delete;
+            CancelFlag& operator=(const CancelFlag&) = delete;
+            
+            const std::atomic_bool& get() const;
+            
+        private:
+            CancelTokenProvider::FlagSlot* m_slot = nullptr;
+            const std::atomic_bool* m_flag = nullptr;
+        };
     }
 }
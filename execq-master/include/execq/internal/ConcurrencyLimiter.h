@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace execq
+{
+    namespace impl
+    {
+        /**
+         * @brief Limits the number of tasks of a provider that run at the same time.
+         * @discussion Fixed limiter allows up to 'maxLimit' tasks. Zero means no limit.
+         * Adaptive limiter starts low and moves its limit between 1 and 'maxLimit' in the spirit of TCP Vegas:
+         * once per window of completions it compares the average task latency with the lowest latency seen,
+         * estimates how many tasks are queued somewhere instead of running and keeps that estimate small.
+         * The limit grows only while it is actually used, so idle streams do not inflate it.
+         * Every few dozen windows the limiter halves the limit for one window to measure the lowest latency anew.
+         */
+        class ConcurrencyLimiter
+        {
+        public:
+            ConcurrencyLimiter(const uint32_t maxLimit, const bool adaptive);
+            
+            bool tryAcquire();
+            
+            /**
+             * @return true if the limit has grown and more tasks may be started.
+             */
+            bool release(const std::chrono::nanoseconds latency);
+            
+            bool adaptive() const;
+            uint32_t limit() const;
+            
+        private:
+            bool updateLimit(const double averageLatency);
+            
+        private:
+            const uint32_t m_maxLimit = 0;
+            const bool m_adaptive = false;
+            
+            std::atomic<uint32_t> m_limit { 0 };
+            std::atomic<uint32_t> m_inFlight { 0 };
+            
+            // Latency window, guarded by the mutex. Touched only by adaptive limiter
+            std::mutex m_windowMutex;
+            double m_windowLatencySum = 0;
+            uint32_t m_windowSampleCount = 0;
+            uint32_t m_windowMaxInFlight = 0;
+            double m_minLatency = 0;
+            
+            uint32_t m_windowsSinceProbe = 0;
+            uint32_t m_probeSkippedSamples = 0;
+            uint32_t m_probeSavedLimit = 0;
+        };
+    }
+}
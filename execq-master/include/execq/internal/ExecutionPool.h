@@ -24,7 +24,11 @@
 
 #pragma once
 
+#include "execq/PoolOptions.h"
+#include "execq/internal/IdleWorkerStack.h"
+#include "execq/internal/OverflowWorkerGroup.h"
 #include "execq/internal/TaskProviderList.h"
+#include "execq/internal/TimerWheel.h"
 
 #include <atomic>
 #include <memory>
@@ -42,6 +46,23 @@ namespace execq
         
         virtual bool notifyOneWorker() = 0;
         virtual void notifyAllWorkers() = 0;
+        
+        /**
+         * @brief Factory of additional workers for queues and streams of the pool.
+         * @discussion Additional worker runs provider's tasks when notifyOneWorker() fails, i.e. all pool threads are busy.
+         */
+        virtual const impl::IThreadWorkerFactory& additionalWorkerFactory()
+        {
+            return *impl::IThreadWorkerFactory::defaultFactory();
+        }
+        
+        /**
+         * @brief Timer wheel that holds delayed objects of queues of the pool until they are due.
+         */
+        virtual impl::TimerWheel& timerWheel()
+        {
+            return impl::TimerWheel::defaultWheel();
+        }
     };
     
     namespace impl
@@ -49,7 +70,7 @@ namespace execq
         class ExecutionPool: public IExecutionPool
         {
         public:
-            ExecutionPool(const uint32_t threadCount, const IThreadWorkerFactory& workerFactory);
+            ExecutionPool(const uint32_t threadCount, const IThreadWorkerFactory& workerFactory, const PoolOptions& options = PoolOptions());
             
             virtual void addProvider(ITaskProvider& provider) final;
             virtual void removeProvider(ITaskProvider& provider) final;
@@ -57,11 +78,39 @@ namespace execq
             virtual bool notifyOneWorker() final;
             virtual void notifyAllWorkers() final;
             
+            virtual const IThreadWorkerFactory& additionalWorkerFactory() final;
+            virtual TimerWheel& timerWheel() final;
+            
+        private:
+            class OverflowWorkerFactory: public IThreadWorkerFactory
+            {
+            public:
+                explicit OverflowWorkerFactory(OverflowWorkerGroup& group);
+                virtual std::unique_ptr<IThreadWorker> createWorker(ITaskProvider& provider) const final;
+                
+            private:
+                OverflowWorkerGroup& m_group;
+            };
+            
+        private:
+            const OverflowPolicy m_overflowPolicy;
+            OverflowWorkerGroup m_overflowGroup;
+            const OverflowWorkerFactory m_overflowWorkerFactory;
+            
+            TaskProviderList& providerList(const ITaskProvider& provider);
+            
         private:
             std::atomic_bool m_valid { true };
+            TaskProviderList m_highPriorityProviderGroup;
             TaskProviderList m_providerGroup;
             
+            // Each worker asks for tasks through its own provider, which reports the worker idle when there are none
+            IdleWorkerStack m_idleWorkers;
+            std::vector<std::unique_ptr<ITaskProvider>> m_workerProviders;
+            
             std::vector<std::unique_ptr<IThreadWorker>> m_workers;
+            
+            TimerWheel m_timerWheel;
         };
         
         
@@ -24,11 +24,11 @@
 
 #pragma once
 
-#include "execq/IExecutionQueue.h"
-#include "execq/internal/CancelTokenProvider.h"
-#include "execq/internal/ExecutionPool.h"
+#include "execq/internal/QueueBase.h"
 
-#include <queue>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 namespace execq
 {
@@ -37,56 +37,52 @@ namespace execq
         template <typename R, typename T>
         struct QueuedObject
         {
-            std::unique_ptr<T> object;
+            T object;
             std::promise<R> promise;
             CancelToken cancelToken;
         };
         
         template <typename R, typename T>
-        class ExecutionQueue: public IExecutionQueue<R(T)>, private ITaskProvider
+        class ExecutionQueue: public QueueBase<ExecutionQueue<R, T>, R, T, QueuedObject<R, T>>
         {
+            using Base = QueueBase<ExecutionQueue<R, T>, R, T, QueuedObject<R, T>>;
+            
         public:
             ExecutionQueue(const bool serial, std::shared_ptr<IExecutionPool> executionPool,
                            const IThreadWorkerFactory& workerFactory,
-                           std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor);
+                           std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                           const QueueOptions& options = QueueOptions());
             ~ExecutionQueue();
             
-        public: // IExecutionQueue
-            virtual void cancel() final;
-            
-        private: // IExecutionQueue
-            virtual std::future<R> pushImpl(std::unique_ptr<T> object) final;
-            
         private: // IThreadWorkerPoolTaskProvider
             virtual Task nextTask() final;
             
         private:
+            friend Base;
+            void enqueue(T&& object, std::promise<R>&& promise, const CancelToken cancelToken);
+            
             void execute(T&& object, std::promise<void>& promise, const std::atomic_bool& canceled);
             template <typename Y>
             void execute(T&& object, std::promise<Y>& promise, const std::atomic_bool& canceled);
             
-            void pushObject(std::unique_ptr<QueuedObject<R, T>> object, bool& alreadyHasTask);
-            std::unique_ptr<QueuedObject<R, T>> popObject();
-            
-            void notifyWorkers();
-            bool hasTask();
-            void waitAllTasks();
+            bool executeNextObject();
+            void executeBatch();
+            void returnObjects(std::vector<QueuedObject<R, T>>& objects, const size_t first);
             
         private:
-            std::atomic_size_t m_taskRunningCount { 0 };
-            
-            std::atomic_bool m_hasTask { false };
-            std::queue<std::unique_ptr<QueuedObject<R, T>>> m_taskQueue;
-            std::mutex m_taskQueueMutex;
-            std::condition_variable m_taskQueueCondition;
-            
-            CancelTokenProvider m_cancelTokenProvider;
+            using Base::m_taskRunningCount;
+            using Base::m_hasTask;
+            using Base::m_taskQueue;
+            using Base::m_taskQueueMutex;
+            using Base::m_taskQueueCondition;
+            using Base::m_cancelTokenProvider;
+            using Base::notifyWorkers;
+            using Base::renotifyWorkers;
             
             const bool m_isSerial = false;
-            const std::shared_ptr<IExecutionPool> m_executionPool;
+            const uint32_t m_batchSize = 1;
+            const std::chrono::microseconds m_batchDuration;
             const std::function<R(const std::atomic_bool& isCanceled, T&& object)> m_executor;
-            
-            const std::unique_ptr<IThreadWorker> m_additionalWorker;
         };
     }
 }
@@ -94,57 +90,21 @@ namespace execq
 template <typename R, typename T>
 execq::impl::ExecutionQueue<R, T>::ExecutionQueue(const bool serial, std::shared_ptr<IExecutionPool> executionPool,
                                                   const IThreadWorkerFactory& workerFactory,
-                                                  std::function<R(const std::atomic_bool& shouldQuit, T&& object)> executor)
-: m_isSerial(serial)
-, m_executionPool(executionPool)
+                                                  std::function<R(const std::atomic_bool& shouldQuit, T&& object)> executor,
+                                                  const QueueOptions& options)
+: Base(std::move(executionPool), workerFactory, options.scheduling)
+, m_isSerial(serial)
+, m_batchSize(std::max<uint32_t>(options.batchSize, 1))
+, m_batchDuration(options.batchDuration)
 , m_executor(std::move(executor))
-, m_additionalWorker(workerFactory.createWorker(*this))
 {
-    if (m_executionPool)
-    {
-        m_executionPool->addProvider(*this);
-    }
+    Base::attachToPool();
 }
 
 template <typename R, typename T>
 execq::impl::ExecutionQueue<R, T>::~ExecutionQueue()
 {
-    m_cancelTokenProvider.cancel();
-    waitAllTasks();
-    if (m_executionPool)
-    {
-        m_executionPool->removeProvider(*this);
-    }
-}
-
-// IExecutionQueue
-
-template <typename R, typename T>
-std::future<R> execq::impl::ExecutionQueue<R, T>::pushImpl(std::unique_ptr<T> object)
-{
-    using QueuedObject = QueuedObject<R, T>;
-    
-    std::promise<R> promise;
-    std::future<R> future = promise.get_future();
-    
-    std::unique_ptr<QueuedObject> queuedObject(new QueuedObject { std::move(object), std::move(promise), m_cancelTokenProvider.token() });
-    
-    bool alreadyHasTask = false;
-    pushObject(std::move(queuedObject), alreadyHasTask);
-    
-    const bool shouldNotify = !m_isSerial || !alreadyHasTask;
-    if (shouldNotify)
-    {
-        notifyWorkers();
-    }
-    
-    return future;
-}
-
-template <typename R, typename T>
-void execq::impl::ExecutionQueue<R, T>::cancel()
-{
-    m_cancelTokenProvider.cancelAndRenew();
+    Base::shutdown([] {});
 }
 
 // IThreadWorkerPoolTaskProvider
@@ -152,18 +112,26 @@ void execq::impl::ExecutionQueue<R, T>::cancel()
 template <typename R, typename T>
 execq::impl::Task execq::impl::ExecutionQueue<R, T>::nextTask()
 {
-    if (!hasTask())
+    if (!m_hasTask)
     {
         return Task();
     }
     
-    m_taskRunningCount++;
-    return Task([&] {
-        std::unique_ptr<QueuedObject<R, T>> object = popObject();
-        if (object)
+    if (m_isSerial)
+    {
+        // Pool threads and the additional worker may ask at the same time: only one of them wins the queue
+        size_t running = 0;
+        if (!m_taskRunningCount.compare_exchange_strong(running, 1))
         {
-            execute(std::move(*object->object), object->promise, *object->cancelToken);
+            return Task();
         }
+    }
+    else
+    {
+        m_taskRunningCount++;
+    }
+    return Task([this] {
+        executeBatch();
         
         if (--m_taskRunningCount > 0)
         {
@@ -172,11 +140,13 @@ execq::impl::Task execq::impl::ExecutionQueue<R, T>::nextTask()
         
         if (!m_hasTask)
         {
+            // Under the lock, otherwise waitAllTasks may miss the notification between its check and wait
+            std::lock_guard<std::mutex> lock(m_taskQueueMutex);
             m_taskQueueCondition.notify_all();
         }
         else if (m_isSerial) // if there are more tasks and queue is serial, notify workers
         {
-            notifyWorkers();
+            renotifyWorkers();
         }
     });
 }
@@ -184,77 +154,133 @@ execq::impl::Task execq::impl::ExecutionQueue<R, T>::nextTask()
 // Private
 
 template <typename R, typename T>
-void execq::impl::ExecutionQueue<R, T>::execute(T&& object, std::promise<void>& promise, const std::atomic_bool& canceled)
+void execq::impl::ExecutionQueue<R, T>::enqueue(T&& object, std::promise<R>&& promise, const CancelToken cancelToken)
 {
-    m_executor(canceled, std::move(object));
-    promise.set_value();
+    bool alreadyHasTask = false;
+    {
+        std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+        
+        alreadyHasTask = m_hasTask;
+        m_hasTask = true;
+        m_taskQueue.emplace(std::move(object), std::move(promise), cancelToken);
+    }
+    
+    const bool shouldNotify = !m_isSerial || !alreadyHasTask;
+    if (shouldNotify)
+    {
+        notifyWorkers();
+    }
 }
 
 template <typename R, typename T>
-template <typename Y>
-void execq::impl::ExecutionQueue<R, T>::execute(T&& object, std::promise<Y>& promise, const std::atomic_bool& canceled)
+void execq::impl::ExecutionQueue<R, T>::execute(T&& object, std::promise<void>& promise, const std::atomic_bool& canceled)
 {
-    promise.set_value(m_executor(canceled, std::move(object)));
+    try
+    {
+        m_executor(canceled, std::move(object));
+        promise.set_value();
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
 }
 
 template <typename R, typename T>
-void execq::impl::ExecutionQueue<R, T>::pushObject(std::unique_ptr<QueuedObject<R, T>> object, bool& alreadyHasTask)
+template <typename Y>
+void execq::impl::ExecutionQueue<R, T>::execute(T&& object, std::promise<Y>& promise, const std::atomic_bool& canceled)
 {
-    std::lock_guard<std::mutex> lock(m_taskQueueMutex);
-    
-    alreadyHasTask = m_hasTask;
-    m_hasTask = true;
-    m_taskQueue.push(std::move(object));
+    try
+    {
+        promise.set_value(m_executor(canceled, std::move(object)));
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
 }
 
 template <typename R, typename T>
-std::unique_ptr<execq::impl::QueuedObject<R, T>> execq::impl::ExecutionQueue<R, T>::popObject()
+bool execq::impl::ExecutionQueue<R, T>::executeNextObject()
 {
-    std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+    std::unique_lock<std::mutex> lock(m_taskQueueMutex);
     if (m_taskQueue.empty())
     {
-        return nullptr;
+        return false;
     }
     
-    std::unique_ptr<QueuedObject<R, T>> object = std::move(m_taskQueue.front());
+    QueuedObject<R, T> object(std::move(m_taskQueue.front()));
     m_taskQueue.pop();
-    
     m_hasTask = !m_taskQueue.empty();
+    lock.unlock();
+    
+    const CancelFlag canceled(m_cancelTokenProvider, object.cancelToken);
+    execute(std::move(object.object), object.promise, canceled.get());
     
-    return object;
+    return true;
 }
 
 template <typename R, typename T>
-bool execq::impl::ExecutionQueue<R, T>::hasTask()
+void execq::impl::ExecutionQueue<R, T>::executeBatch()
 {
-    if (!m_hasTask)
+    if (m_batchSize == 1)
     {
-        return false;
+        executeNextObject();
+        return;
     }
     
-    if (!m_isSerial)
+    // The whole batch is taken under one lock hold.
+    // Buffer is per worker thread and keeps its capacity, so a batch does not allocate.
+    // A batch run from inside another one (e.g. a test driving the pool by hand) gets its own buffer
+    static thread_local std::vector<QueuedObject<R, T>> s_batch;
+    std::vector<QueuedObject<R, T>> nestedBatch;
+    std::vector<QueuedObject<R, T>>& batch = s_batch.empty() ? s_batch : nestedBatch;
     {
-        return true;
+        std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+        const size_t count = std::min<size_t>(m_batchSize, m_taskQueue.size());
+        batch.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            batch.push_back(std::move(m_taskQueue.front()));
+            m_taskQueue.pop();
+        }
+        m_hasTask = !m_taskQueue.empty();
     }
     
-    return !m_taskRunningCount;
-}
-
-template <typename R, typename T>
-void execq::impl::ExecutionQueue<R, T>::notifyWorkers()
-{
-    if (!m_executionPool || !m_executionPool->notifyOneWorker())
+    const bool timeLimited = m_batchDuration.count() > 0;
+    const auto deadline = timeLimited ? std::chrono::steady_clock::now() + m_batchDuration : std::chrono::steady_clock::time_point();
+    
+    // Batch is bounded by size and time so a busy queue can't hold a pool thread away from other providers
+    for (size_t i = 0; i < batch.size(); i++)
     {
-        m_additionalWorker->notifyWorker();
+        if (i > 0 && timeLimited && std::chrono::steady_clock::now() >= deadline)
+        {
+            returnObjects(batch, i);
+            break;
+        }
+        
+        const CancelFlag canceled(m_cancelTokenProvider, batch[i].cancelToken);
+        execute(std::move(batch[i].object), batch[i].promise, canceled.get());
     }
+    
+    batch.clear();
 }
 
 template <typename R, typename T>
-void execq::impl::ExecutionQueue<R, T>::waitAllTasks()
+void execq::impl::ExecutionQueue<R, T>::returnObjects(std::vector<QueuedObject<R, T>>& objects, const size_t first)
 {
-    std::unique_lock<std::mutex> lock(m_taskQueueMutex);
-    while (m_taskRunningCount > 0 || !m_taskQueue.empty())
     {
-        m_taskQueueCondition.wait(lock);
+        std::lock_guard<std::mutex> lock(m_taskQueueMutex);
+        for (size_t i = objects.size(); i > first; i--)
+        {
+            m_taskQueue.emplaceFront(std::move(objects[i - 1]));
+        }
+        m_hasTask = true;
+    }
+    
+    // Serial queue is renotified when the running task finishes
+    if (!m_isSerial)
+    {
+        notifyWorkers();
     }
 }
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "execq/IExecutionStream.h"
+#include "execq/internal/ConcurrencyLimiter.h"
 #include "execq/internal/ExecutionPool.h"
 
 #include <mutex>
@@ -41,17 +42,21 @@ namespace execq
         public:
             ExecutionStream(std::shared_ptr<IExecutionPool> executionPool,
                             const IThreadWorkerFactory& workerFactory,
-                            std::function<void(const std::atomic_bool& isCanceled)> executee);
+                            std::function<void(const std::atomic_bool& isCanceled)> executee,
+                            const StreamOptions& options = StreamOptions());
             ~ExecutionStream();
             
         public: // IExecutionStream
             virtual void start() final;
             virtual void stop() final;
+            virtual uint64_t servedTaskCount() const final;
             
         private: // ITaskProvider
             virtual Task nextTask() final;
             
         private:
+            bool acquireTaskSlot();
+            void execute();
             void waitPendingTasks();
             
         private:
@@ -61,6 +66,9 @@ namespace execq
             std::mutex m_taskCompleteMutex;
             std::condition_variable m_taskCompleteCondition;
             
+            ConcurrencyLimiter m_concurrencyLimiter;
+            std::atomic_bool m_throttled { false };
+            
             const std::shared_ptr<IExecutionPool> m_executionPool;
             const std::function<void(const std::atomic_bool& shouldQuit)> m_executee;
             
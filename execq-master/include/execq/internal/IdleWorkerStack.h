@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace execq
+{
+    namespace impl
+    {
+        /**
+         * @brief LIFO set of idle worker indices.
+         * @discussion pop() returns the most recently pushed worker: it parked last, so its cache is the warmest.
+         * Pushing a worker that is already in the set moves it to the top. All operations are O(1):
+         * workers are linked in a list through per-worker prev/next indices, guarded by a short lock.
+         * pop() on an empty set and remove() of a worker that is not in the set do not take the lock.
+         */
+        class IdleWorkerStack
+        {
+        public:
+            explicit IdleWorkerStack(const uint32_t capacity);
+            
+            void push(const uint32_t index);
+            bool pop(uint32_t& index);
+            
+            /**
+             * @brief Takes the worker out of the set, e.g. when it was woken by someone else and took a task.
+             */
+            void remove(const uint32_t index);
+            
+        private:
+            void unlink(const uint32_t index);
+            
+        private:
+            std::mutex m_mutex;
+            uint32_t m_top;
+            std::unique_ptr<uint32_t[]> m_prev;
+            std::unique_ptr<uint32_t[]> m_next;
+            
+            // Readable without the lock: fast paths of pop() and remove()
+            std::atomic<uint32_t> m_size { 0 };
+            std::unique_ptr<std::atomic_bool[]> m_inStack;
+        };
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "execq/internal/ThreadWorker.h"
+
+#include <deque>
+#include <vector>
+
+namespace execq
+{
+    namespace impl
+    {
+        class OverflowWorker;
+        
+        /**
+         * @brief Group of threads shared by additional workers of all queues and streams of the pool.
+         * @discussion Workers created by the group do not own threads. Notified worker is put in line and served by the next free thread.
+         * Threads are created on demand, up to 'maxThreadCount'. Served worker goes to the end of the line,
+         * so when all threads are busy the waiting providers are served in turn.
+         * Threads never retire: an idle thread waits for the next worker until the group is destroyed.
+         */
+        class OverflowWorkerGroup
+        {
+        public:
+            explicit OverflowWorkerGroup(const uint32_t maxThreadCount);
+            ~OverflowWorkerGroup();
+            
+            std::unique_ptr<IThreadWorker> createWorker(ITaskProvider& provider);
+            
+            size_t threadCount();
+            
+        private:
+            friend class OverflowWorker;
+            bool schedule(OverflowWorker& worker);
+            void unschedule(OverflowWorker& worker);
+            
+            void threadMain();
+            
+        private:
+            const uint32_t m_maxThreadCount = 0;
+            
+            bool m_shouldQuit = false;
+            uint32_t m_idleThreadCount = 0;
+            std::deque<OverflowWorker*> m_pendingWorkers;
+            std::vector<std::thread> m_threads;
+            
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            std::condition_variable m_workerReleasedCondition;
+        };
+    }
+}
@@ -0,0 +1,254 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "execq/IExecutionQueue.h"
+#include "execq/internal/CancelTokenProvider.h"
+#include "execq/internal/ExecutionPool.h"
+#include "execq/internal/RingQueue.h"
+
+#include <chrono>
+
+namespace execq
+{
+    namespace impl
+    {
+        /**
+         * @brief Machinery shared by pool-based queues: delayed pushes, cancelation, worker notification and waiting for tasks.
+         * @discussion 'Queue' is the derived class. It provides 'enqueue(T&&, std::promise<R>&&, CancelToken)'
+         * that puts a due object into m_taskQueue, and implements ITaskProvider::nextTask.
+         * Derived destructor calls shutdown() before its own members are destroyed.
+         */
+        template <typename Queue, typename R, typename T, typename Object>
+        class QueueBase: public IExecutionQueue<R(T)>, protected ITaskProvider
+        {
+        public:
+            QueueBase(std::shared_ptr<IExecutionPool> executionPool, const IThreadWorkerFactory& workerFactory,
+                      const SchedulingOptions& schedulingOptions);
+            
+        public: // IExecutionQueue
+            virtual void cancel() final;
+            virtual uint64_t servedTaskCount() const final;
+            
+        private: // IExecutionQueue
+            virtual std::future<R> pushImpl(T&& object) final;
+            virtual std::future<R> pushAtImpl(const std::chrono::steady_clock::time_point time, T&& object) final;
+            
+        protected:
+            /**
+             * @brief Registers the queue in the pool. Called by the derived constructor, when nextTask is ready to be called.
+             */
+            void attachToPool();
+            
+            /**
+             * @brief Cancels pending objects, waits all tasks to finish and stops workers.
+             * @discussion 'beforeWait' runs after delayed objects are expired, e.g. to wake a batch waiting for more objects.
+             */
+            template <typename F>
+            void shutdown(F beforeWait);
+            
+            void notifyWorkers();
+            
+            /**
+             * @brief Notifies workers about tasks left when the running task finishes.
+             * @discussion The finishing worker asks for the next task right after, so the additional worker is not woken
+             * when no pool worker is idle.
+             */
+            void renotifyWorkers();
+            
+        protected:
+            std::atomic_size_t m_taskRunningCount { 0 };
+            
+            std::atomic_bool m_hasTask { false };
+            RingQueue<Object> m_taskQueue;
+            std::mutex m_taskQueueMutex;
+            std::condition_variable m_taskQueueCondition;
+            
+            CancelTokenProvider m_cancelTokenProvider;
+            
+        private:
+            class DelayedObject: public TimerWheel::Timer
+            {
+            public:
+                DelayedObject(QueueBase& queue, T&& object, std::promise<R>&& promise, const CancelToken cancelToken);
+                
+                virtual void fire() final;
+                virtual const void* owner() const final;
+                
+            private:
+                QueueBase& m_queue;
+                T m_object;
+                std::promise<R> m_promise;
+                const CancelToken m_cancelToken;
+            };
+            
+            void waitAllTasks();
+            
+        private:
+            std::atomic_size_t m_delayedCount { 0 };
+            TimerWheel& m_timerWheel;
+            
+            const std::shared_ptr<IExecutionPool> m_executionPool;
+            std::unique_ptr<IThreadWorker> m_additionalWorker;
+        };
+    }
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+execq::impl::QueueBase<Queue, R, T, Object>::QueueBase(std::shared_ptr<IExecutionPool> executionPool, const IThreadWorkerFactory& workerFactory,
+                                                       const SchedulingOptions& schedulingOptions)
+: ITaskProvider(schedulingOptions)
+, m_timerWheel(executionPool ? executionPool->timerWheel() : TimerWheel::defaultWheel())
+, m_executionPool(executionPool)
+, m_additionalWorker(workerFactory.createWorker(*this))
+{}
+
+// IExecutionQueue
+
+template <typename Queue, typename R, typename T, typename Object>
+void execq::impl::QueueBase<Queue, R, T, Object>::cancel()
+{
+    m_cancelTokenProvider.cancelAndRenew();
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+uint64_t execq::impl::QueueBase<Queue, R, T, Object>::servedTaskCount() const
+{
+    return ITaskProvider::servedTaskCount();
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+std::future<R> execq::impl::QueueBase<Queue, R, T, Object>::pushImpl(T&& object)
+{
+    std::promise<R> promise;
+    std::future<R> future = promise.get_future();
+    static_cast<Queue&>(*this).enqueue(std::move(object), std::move(promise), m_cancelTokenProvider.token());
+    
+    return future;
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+std::future<R> execq::impl::QueueBase<Queue, R, T, Object>::pushAtImpl(const std::chrono::steady_clock::time_point time, T&& object)
+{
+    if (time <= std::chrono::steady_clock::now())
+    {
+        return pushImpl(std::move(object));
+    }
+    
+    std::promise<R> promise;
+    std::future<R> future = promise.get_future();
+    
+    m_delayedCount++;
+    m_timerWheel.schedule(std::unique_ptr<TimerWheel::Timer>(new DelayedObject(*this, std::move(object), std::move(promise), m_cancelTokenProvider.token())),
+                          time);
+    
+    return future;
+}
+
+// Protected
+
+template <typename Queue, typename R, typename T, typename Object>
+void execq::impl::QueueBase<Queue, R, T, Object>::attachToPool()
+{
+    if (m_executionPool)
+    {
+        m_executionPool->addProvider(*this);
+    }
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+template <typename F>
+void execq::impl::QueueBase<Queue, R, T, Object>::shutdown(F beforeWait)
+{
+    m_cancelTokenProvider.cancel();
+    if (m_delayedCount > 0)
+    {
+        m_timerWheel.expire(this);
+    }
+    beforeWait();
+    waitAllTasks();
+    if (m_executionPool)
+    {
+        m_executionPool->removeProvider(*this);
+    }
+    
+    // The worker may still be asking the queue for tasks: it is stopped while the derived queue is alive
+    m_additionalWorker.reset();
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+void execq::impl::QueueBase<Queue, R, T, Object>::notifyWorkers()
+{
+    markReady();
+    if (!m_executionPool || !m_executionPool->notifyOneWorker())
+    {
+        m_additionalWorker->notifyWorker();
+    }
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+void execq::impl::QueueBase<Queue, R, T, Object>::renotifyWorkers()
+{
+    markReady();
+    if (m_executionPool)
+    {
+        m_executionPool->notifyOneWorker();
+    }
+}
+
+// Private
+
+template <typename Queue, typename R, typename T, typename Object>
+void execq::impl::QueueBase<Queue, R, T, Object>::waitAllTasks()
+{
+    std::unique_lock<std::mutex> lock(m_taskQueueMutex);
+    while (m_taskRunningCount > 0 || !m_taskQueue.empty())
+    {
+        m_taskQueueCondition.wait(lock);
+    }
+}
+
+// DelayedObject
+
+template <typename Queue, typename R, typename T, typename Object>
+execq::impl::QueueBase<Queue, R, T, Object>::DelayedObject::DelayedObject(QueueBase& queue, T&& object, std::promise<R>&& promise, const CancelToken cancelToken)
+: m_queue(queue)
+, m_object(std::move(object))
+, m_promise(std::move(promise))
+, m_cancelToken(cancelToken)
+{}
+
+template <typename Queue, typename R, typename T, typename Object>
+void execq::impl::QueueBase<Queue, R, T, Object>::DelayedObject::fire()
+{
+    static_cast<Queue&>(m_queue).enqueue(std::move(m_object), std::move(m_promise), m_cancelToken);
+    m_queue.m_delayedCount--;
+}
+
+template <typename Queue, typename R, typename T, typename Object>
+const void* execq::impl::QueueBase<Queue, R, T, Object>::DelayedObject::owner() const
+{
+    return &m_queue;
+}
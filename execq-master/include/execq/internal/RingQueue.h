@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace execq
+{
+    namespace impl
+    {
+        /**
+         * @brief FIFO queue over a growable power-of-two ring buffer.
+         * @discussion Unlike std::queue (std::deque) it does not allocate once the buffer reached its working size.
+         * Not thread-safe.
+         */
+        template <typename T>
+        class RingQueue
+        {
+        public:
+            RingQueue() = default;
+            ~RingQueue();
+            
+            RingQueue(const RingQueue&) = delete;
+            RingQueue& operator=(const RingQueue&) = delete;
+            
+            bool empty() const { return m_size == 0; }
+            size_t size() const { return m_size; }
+            
+            template <typename... Args>
+            void emplace(Args&&... args);
+            
+            template <typename... Args>
+            void emplaceFront(Args&&... args);
+            
+            T& front() { return *at(0); }
+            void pop();
+            
+        private:
+            using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+            
+            T* at(const size_t i) { return reinterpret_cast<T*>(&m_buffer[(m_head + i) & (m_capacity - 1)]); }
+            void grow();
+            
+        private:
+            static const size_t kInitialCapacity = 16;
+            
+            std::unique_ptr<Storage[]> m_buffer;
+            size_t m_capacity = 0;
+            size_t m_head = 0;
+            size_t m_size = 0;
+        };
+    }
+}
+
+template <typename T>
+execq::impl::RingQueue<T>::~RingQueue()
+{
+    while (!empty())
+    {
+        pop();
+    }
+}
+
+template <typename T>
+template <typename... Args>
+void execq::impl::RingQueue<T>::emplace(Args&&... args)
+{
+    if (m_size == m_capacity)
+    {
+        grow();
+    }
+    
+    new (at(m_size)) T { std::forward<Args>(args)... };
+    m_size++;
+}
+
+template <typename T>
+template <typename... Args>
+void execq::impl::RingQueue<T>::emplaceFront(Args&&... args)
+{
+    if (m_size == m_capacity)
+    {
+        grow();
+    }
+    
+    m_head = (m_head - 1) & (m_capacity - 1);
+    new (at(0)) T { std::forward<Args>(args)... };
+    m_size++;
+}
+
+template <typename T>
+void execq::impl::RingQueue<T>::pop()
+{
+    at(0)->~T();
+    m_head = (m_head + 1) & (m_capacity - 1);
+    m_size--;
+}
+
+template <typename T>
+void execq::impl::RingQueue<T>::grow()
+{
+    const size_t capacity = m_capacity ? m_capacity * 2 : kInitialCapacity;
+    std::unique_ptr<Storage[]> buffer(new Storage[capacity]);
+    for (size_t i = 0; i < m_size; i++)
+    {
+        T* const object = at(i);
+        new (&buffer[i]) T(std::move(*object));
+        object->~T();
+    }
+    
+    m_buffer = std::move(buffer);
+    m_capacity = capacity;
+    m_head = 0;
+}
@@ -27,14 +27,26 @@
 #include "execq/internal/ThreadWorker.h"
 
 #include <mutex>
-#include <list>
+#include <vector>
 
 namespace execq
 {
     namespace impl
     {
+        /**
+         * @brief Deficit round-robin scheduler over task providers, shared by all workers of a pool.
+         * @discussion nextTask() takes no locks. Providers live in chunks of 64 slots that are never freed while the list exists.
+         * Each chunk has a 'ready' bitmap, so workers skip providers that have no tasks without calling them.
+         * Each worker thread keeps its own round-robin cursor, which stays on a provider for up to SchedulingOptions::weight tasks in a row.
+         * Removing a provider waits until no worker is inside a call to that provider.
+         * SchedulingOptions::priority is not handled here: the pool keeps a separate list per priority.
+         */
         class TaskProviderList: public ITaskProvider
         {
+        public:
+            TaskProviderList() = default;
+            ~TaskProviderList();
+            
         public: // ITaskProvider
             virtual Task nextTask() final;
             
@@ -43,12 +55,41 @@ namespace execq
             void removeProvider(ITaskProvider& provider);
             
         private:
-            using TaskProviders_lt = std::list<ITaskProvider*>;
-            TaskProviders_lt m_taskProviders;
-            TaskProviders_lt::iterator m_currentTaskProviderIt;
+            static const size_t kChunkSize = 64;
+            static const size_t kCursorCount = 16;
+            
+            struct Slot
+            {
+                std::atomic<ITaskProvider*> provider { nullptr };
+                std::atomic<uint32_t> pins { 0 };
+                std::atomic<uint32_t> weight { 1 };
+            };
+            
+            struct Chunk
+            {
+                std::atomic<uint64_t> bits[2]; // 'ready' and 'signaled' bitmaps, see ITaskProvider::markReady
+                std::atomic<Chunk*> next { nullptr };
+                Slot slots[kChunkSize];
+            };
+            
+            struct Cursor
+            {
+                std::atomic<Chunk*> chunk { nullptr };
+                std::atomic<size_t> index { 0 };
+                std::atomic<uint32_t> served { 0 }; // tasks taken in a row from the provider at 'index'
+                char padding[64 - sizeof(std::atomic<Chunk*>) - sizeof(std::atomic<size_t>) - sizeof(std::atomic<uint32_t>)];
+            };
+            
+            Task tryProvider(Chunk& chunk, const size_t index);
+            
+        private:
+            std::atomic<Chunk*> m_head { nullptr };
+            std::atomic<size_t> m_chunkCount { 0 };
+            Cursor m_cursors[kCursorCount];
+            
+            Chunk* m_tail = nullptr;
+            std::vector<std::pair<Chunk*, size_t>> m_freeSlots;
             std::mutex m_mutex;
         };
     }
 }
-
-
@@ -24,23 +24,79 @@
 
 #pragma once
 
+#include "execq/SchedulingOptions.h"
+
 #include <mutex>
 #include <atomic>
+#include <cstdint>
 #include <thread>
-#include <future>
+#include <functional>
+#include <type_traits>
 #include <condition_variable>
 
 namespace execq
 {
     namespace impl
     {
-        using Task = std::packaged_task<void()>;
+        /**
+         * @brief Unit of work handed out by ITaskProvider::nextTask.
+         * @discussion Small callables (e.g. lambdas capturing only 'this') are stored inline, so creating a Task does not allocate.
+         * Default-constructed Task is not valid and means 'no task'.
+         */
+        class Task
+        {
+        public:
+            Task() = default;
+            
+            template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+            explicit Task(F&& function)
+            : m_function(std::forward<F>(function))
+            {}
+            
+            bool valid() const
+            {
+                return static_cast<bool>(m_function);
+            }
+            
+            void operator()()
+            {
+                m_function();
+            }
+            
+        private:
+            std::function<void()> m_function;
+        };
+        
         class ITaskProvider
         {
         public:
+            explicit ITaskProvider(const SchedulingOptions& schedulingOptions = SchedulingOptions());
             virtual ~ITaskProvider() = default;
             
             virtual Task nextTask() = 0;
+            
+        public:
+            const SchedulingOptions& schedulingOptions() const;
+            
+            /**
+             * @brief Number of valid tasks TaskProviderList has taken from the provider.
+             */
+            uint64_t servedTaskCount() const;
+            
+            /**
+             * @brief Tells the TaskProviderList the provider is registered in that nextTask() may return a valid task.
+             * @discussion The list skips providers that returned no task until they are marked ready again,
+             * so providers must call it each time new work becomes available. No-op for unregistered providers.
+             */
+            void markReady();
+            
+        private:
+            friend class TaskProviderList;
+            std::atomic<std::atomic<uint64_t>*> m_readyBits { nullptr };
+            uint64_t m_readyMask = 0;
+            std::atomic<uint64_t> m_servedTaskCount { 0 };
+            
+            const SchedulingOptions m_schedulingOptions;
         };
         
         
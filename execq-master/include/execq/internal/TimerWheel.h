@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace execq
+{
+    namespace impl
+    {
+        /**
+         * @brief Hashed timer wheel shared by delayed objects of all queues of the pool.
+         * @discussion Timers are hashed by due tick into a ring of slots. One thread, started on first use, sleeps until the next
+         * non-empty slot and fires timers that are due. Timers are intrusive, so a pending timer costs one allocation of the owner.
+         * Pending timers are also linked per owner, so expire() touches only the timers of the owner.
+         * Timers are fired with the wheel unlocked.
+         */
+        class TimerWheel
+        {
+        public:
+            using Clock = std::chrono::steady_clock;
+            
+            class Timer
+            {
+            public:
+                virtual ~Timer() = default;
+                
+                /**
+                 * @brief Called on the wheel thread when the timer is due, or from expire(). Timer is destroyed right after.
+                 * @discussion The wheel is not locked, so the timer may schedule other timers.
+                 */
+                virtual void fire() = 0;
+                
+                virtual const void* owner() const = 0;
+                
+            private:
+                friend class TimerWheel;
+                
+                // Slot list, then the list of fired timers once unlinked
+                Timer* m_next = nullptr;
+                Timer** m_link = nullptr;
+                
+                Timer* m_ownerNext = nullptr;
+                Timer** m_ownerLink = nullptr;
+                
+                uint64_t m_dueTick = 0;
+            };
+            
+        public:
+            explicit TimerWheel(const Clock::duration tick = std::chrono::milliseconds(1), const uint32_t slotCount = 4096);
+            ~TimerWheel();
+            
+            /**
+             * @brief Process-wide wheel for queues without execution pool.
+             */
+            static TimerWheel& defaultWheel();
+            
+            void schedule(std::unique_ptr<Timer> timer, const Clock::time_point dueTime);
+            
+            /**
+             * @brief Fires all pending timers of the owner immediately.
+             * @discussion When returns, no timer of the owner is pending or being fired.
+             */
+            void expire(const void* owner);
+            
+            size_t pendingCount();
+            
+        private:
+            void threadMain();
+            
+            uint64_t tickAt(const Clock::time_point time) const;
+            bool nextPendingTick(uint64_t& tick) const;
+            Timer* unlinkDueTimers(const uint64_t currentTick);
+            
+            void link(Timer* timer, Timer*& slot);
+            void unlink(Timer* timer);
+            
+            static void fireTimers(Timer* timers);
+            
+        private:
+            const Clock::duration m_tick;
+            const Clock::time_point m_startTime;
+            
+            std::vector<Timer*> m_slots;
+            std::unordered_map<const void*, Timer*> m_ownerTimers;
+            size_t m_pendingCount = 0;
+            uint64_t m_nextTick = 0;
+            uint64_t m_wakeTick = UINT64_MAX;
+            
+            bool m_shouldQuit = false;
+            bool m_isFiring = false;
+            uint64_t m_firedBatchCount = 0;
+            std::thread m_thread;
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            std::condition_variable m_firedCondition;
+        };
+    }
+}
@@ -24,12 +24,18 @@
 
 #pragma once
 
+#include "execq/internal/BatchExecutionQueue.h"
 #include "execq/internal/ExecutionQueue.h"
 
 namespace execq
 {
     namespace details
     {
+        inline const impl::IThreadWorkerFactory& AdditionalWorkerFactory(const std::shared_ptr<IExecutionPool>& executionPool)
+        {
+            return executionPool ? executionPool->additionalWorkerFactory() : *impl::IThreadWorkerFactory::defaultFactory();
+        }
+        
         template <typename R>
         void ExecuteQueueTask(const std::atomic_bool& isCanceled, QueueTask<R>&& task)
         {
@@ -43,47 +49,76 @@ namespace execq
 
 template <typename R, typename T>
 std::unique_ptr<execq::IExecutionQueue<R(T)>> execq::CreateConcurrentExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
-                                                                                    std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor)
+                                                                                    std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                                                                                    const QueueOptions& options)
 {
     return std::unique_ptr<impl::ExecutionQueue<R, T>>(new impl::ExecutionQueue<R, T>(false,
                                                                                       executionPool,
-                                                                                      *impl::IThreadWorkerFactory::defaultFactory(),
-                                                                                      std::move(executor)));
+                                                                                      details::AdditionalWorkerFactory(executionPool),
+                                                                                      std::move(executor),
+                                                                                      options));
 }
 
 template <typename R, typename T>
 std::unique_ptr<execq::IExecutionQueue<R(T)>> execq::CreateSerialExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
-                                                                                std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor)
+                                                                                std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                                                                                const QueueOptions& options)
 {
-    return std::unique_ptr<impl::ExecutionQueue<R, T>>(new impl::ExecutionQueue<R, T>(false,
+    return std::unique_ptr<impl::ExecutionQueue<R, T>>(new impl::ExecutionQueue<R, T>(true,
                                                                                       executionPool,
-                                                                                      *impl::IThreadWorkerFactory::defaultFactory(),
-                                                                                      std::move(executor)));
+                                                                                      details::AdditionalWorkerFactory(executionPool),
+                                                                                      std::move(executor),
+                                                                                      options));
 }
 
 template <typename R, typename T>
-std::unique_ptr<execq::IExecutionQueue<R(T)>> execq::CreateSerialExecutionQueue(std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor)
+std::unique_ptr<execq::IExecutionQueue<R(T)>> execq::CreateSerialExecutionQueue(std::function<R(const std::atomic_bool& isCanceled, T&& object)> executor,
+                                                                                const QueueOptions& options)
 {
     return std::unique_ptr<impl::ExecutionQueue<R, T>>(new impl::ExecutionQueue<R, T>(true,
                                                                                       nullptr,
                                                                                       *impl::IThreadWorkerFactory::defaultFactory(),
-                                                                                      std::move(executor)));
+                                                                                      std::move(executor),
+                                                                                      options));
+}
+
+template <typename R, typename T>
+std::unique_ptr<execq::IExecutionQueue<R(T)>> execq::CreateBatchExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                                               BatchExecutor<R, T> executor,
+                                                                               const BatchOptions& options)
+{
+    return std::unique_ptr<impl::BatchExecutionQueue<R, T>>(new impl::BatchExecutionQueue<R, T>(executionPool,
+                                                                                                details::AdditionalWorkerFactory(executionPool),
+                                                                                                std::move(executor),
+                                                                                                options));
+}
+
+template <typename R, typename T>
+std::unique_ptr<execq::IExecutionQueue<R(T)>> execq::CreateBatchExecutionQueue(BatchExecutor<R, T> executor,
+                                                                               const BatchOptions& options)
+{
+    return std::unique_ptr<impl::BatchExecutionQueue<R, T>>(new impl::BatchExecutionQueue<R, T>(nullptr,
+                                                                                                *impl::IThreadWorkerFactory::defaultFactory(),
+                                                                                                std::move(executor),
+                                                                                                options));
 }
 
 template <typename R>
-std::unique_ptr<execq::IExecutionQueue<void(execq::QueueTask<R>)>> execq::CreateConcurrentTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool)
+std::unique_ptr<execq::IExecutionQueue<void(execq::QueueTask<R>)>> execq::CreateConcurrentTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                                                                             const QueueOptions& options)
 {
-    return CreateConcurrentExecutionQueue<void, QueueTask<R>>(executionPool, &details::ExecuteQueueTask<R>);
+    return CreateConcurrentExecutionQueue<void, QueueTask<R>>(executionPool, &details::ExecuteQueueTask<R>, options);
 }
 
 template <typename R>
-std::unique_ptr<execq::IExecutionQueue<void(execq::QueueTask<R>)>> execq::CreateSerialTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool)
+std::unique_ptr<execq::IExecutionQueue<void(execq::QueueTask<R>)>> execq::CreateSerialTaskExecutionQueue(std::shared_ptr<IExecutionPool> executionPool,
+                                                                                                         const QueueOptions& options)
 {
-    return CreateSerialExecutionQueue<void, QueueTask<R>>(executionPool, &details::ExecuteQueueTask<R>);
+    return CreateSerialExecutionQueue<void, QueueTask<R>>(executionPool, &details::ExecuteQueueTask<R>, options);
 }
 
 template <typename R>
-std::unique_ptr<execq::IExecutionQueue<void(execq::QueueTask<R>)>> execq::CreateSerialTaskExecutionQueue()
+std::unique_ptr<execq::IExecutionQueue<void(execq::QueueTask<R>)>> execq::CreateSerialTaskExecutionQueue(const QueueOptions& options)
 {
-    return CreateSerialExecutionQueue<void, QueueTask<R>>(&details::ExecuteQueueTask<R>);
+    return CreateSerialExecutionQueue<void, QueueTask<R>>(&details::ExecuteQueueTask<R>, options);
 }
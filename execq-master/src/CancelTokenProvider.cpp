@@ -24,31 +24,158 @@
 
 #include "CancelTokenProvider.h"
 
-execq::impl::CancelToken execq::impl::CancelTokenProvider::token()
+namespace
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_currentToken;
+    const uint32_t kSlotBits = 3;
+    const uint64_t kSlotMask = (1 << kSlotBits) - 1;
+    const uint64_t kNoGeneration = UINT64_MAX;
+    
+    uint64_t TokenGeneration(const execq::impl::CancelToken token)
+    {
+        return token >> kSlotBits;
+    }
+    
+    uint32_t TokenSlot(const execq::impl::CancelToken token)
+    {
+        return static_cast<uint32_t>(token & kSlotMask);
+    }
+    
+    execq::impl::CancelToken MakeToken(const uint64_t generation, const uint32_t slot)
+    {
+        return (generation << kSlotBits) | slot;
+    }
+    
+    // Flag of tokens that outlived their slot: such tokens are canceled
+    const std::atomic_bool s_canceledFlag { true };
+}
+
+execq::impl::CancelTokenProvider::CancelTokenProvider()
+: m_currentToken(MakeToken(0, 0))
+{
+    static_assert((1 << kSlotBits) == kSlotCount, "Slot index should fit kSlotBits");
+    
+    for (FlagSlot& slot : m_slots)
+    {
+        slot.generation = kNoGeneration;
+        slot.useCount = 0;
+        slot.flags.emplace_back(new std::atomic_bool(true));
+        slot.canceled = slot.flags.back().get();
+    }
+    
+    m_slots[0].generation = 0;
+    *m_slots[0].canceled = false;
+}
+
+execq::impl::CancelToken execq::impl::CancelTokenProvider::token() const
+{
+    return m_currentToken.load(std::memory_order_acquire);
+}
+
+bool execq::impl::CancelTokenProvider::isCanceled(const CancelToken token) const
+{
+    // Pins the slot, so its flag is not freed while being read
+    return CancelFlag(*this, token).get();
 }
 
 void execq::impl::CancelTokenProvider::cancel()
 {
-    cancelAndRenew(false);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *m_slots[TokenSlot(m_currentToken)].canceled = true;
 }
 
 void execq::impl::CancelTokenProvider::cancelAndRenew()
 {
-    cancelAndRenew(true);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    const CancelToken currentToken = m_currentToken;
+    const uint32_t currentSlot = TokenSlot(currentToken);
+    *m_slots[currentSlot].canceled = true;
+    
+    releaseOldFlags();
+    
+    // Slots of older generations are reused only when none of their tasks is running
+    uint32_t slot = (currentSlot + 1) & kSlotMask;
+    while (slot != currentSlot && !tryReserveSlot(m_slots[slot]))
+    {
+        slot = (slot + 1) & kSlotMask;
+    }
+    
+    // All of them are in use, possibly by the caller itself: waiting could never end
+    if (slot == currentSlot)
+    {
+        slot = (currentSlot + 1) & kSlotMask;
+        replaceFlag(m_slots[slot]);
+    }
+    
+    const uint64_t generation = TokenGeneration(currentToken) + 1;
+    *m_slots[slot].canceled = false;
+    m_slots[slot].generation = generation;
+    m_currentToken.store(MakeToken(generation, slot), std::memory_order_release);
 }
 
-void execq::impl::CancelTokenProvider::cancelAndRenew(const bool renew)
+bool execq::impl::CancelTokenProvider::tryReserveSlot(FlagSlot& slot)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_currentToken)
+    // Pairs with CancelFlag: either the flag sees the slot taken away, or the slot is seen in use
+    const uint64_t generation = slot.generation.exchange(kNoGeneration);
+    if (slot.useCount == 0)
     {
-        *m_currentToken = true;
+        return true;
     }
-    if (renew)
+    
+    slot.generation = generation;
+    return false;
+}
+
+void execq::impl::CancelTokenProvider::replaceFlag(FlagSlot& slot)
+{
+    // Running tasks keep the old flag, which stays canceled. New CancelFlags of the old generation fail the generation check
+    slot.generation = kNoGeneration;
+    slot.flags.emplace_back(new std::atomic_bool(true));
+    slot.canceled = slot.flags.back().get();
+}
+
+void execq::impl::CancelTokenProvider::releaseOldFlags()
+{
+    // CancelFlag pins the slot before reading its flag: with no users, nobody holds the old flags
+    for (FlagSlot& slot : m_slots)
     {
-        m_currentToken = std::make_shared<std::atomic_bool>(false);
+        if (slot.flags.size() > 1 && slot.useCount == 0)
+        {
+            slot.flags.erase(slot.flags.begin(), slot.flags.end() - 1);
+        }
     }
 }
+
+// CancelFlag
+
+execq::impl::CancelFlag::CancelFlag(const CancelTokenProvider& provider, const CancelToken token)
+{
+    CancelTokenProvider::FlagSlot& slot = provider.m_slots[TokenSlot(token)];
+    slot.useCount++;
+    
+    // The flag is read before the generation: if the generation still matches, the flag was not replaced yet
+    const std::atomic_bool* flag = slot.canceled;
+    if (slot.generation == TokenGeneration(token))
+    {
+        m_slot = &slot;
+        m_flag = flag;
+    }
+    else
+    {
+        slot.useCount--;
+        m_flag = &s_canceledFlag;
+    }
+}
+
+execq::impl::CancelFlag::~CancelFlag()
+{
+    if (m_slot)
+    {
+        m_slot->useCount--;
+    }
+}
+
+const std::atomic_bool& execq::impl::CancelFlag::get() const
+{
+    return *m_flag;
+}
@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ConcurrencyLimiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    const uint32_t kAdaptiveInitialLimit = 4;
+    const uint32_t kAdaptiveDefaultMaxLimit = 256;
+    const uint32_t kMinWindowSize = 8;
+    const uint32_t kProbeInterval = 64; // windows
+}
+
+execq::impl::ConcurrencyLimiter::ConcurrencyLimiter(const uint32_t maxLimit, const bool adaptive)
+: m_maxLimit(adaptive && !maxLimit ? kAdaptiveDefaultMaxLimit : maxLimit)
+, m_adaptive(adaptive)
+{
+    if (m_adaptive)
+    {
+        m_limit = std::min(kAdaptiveInitialLimit, m_maxLimit);
+    }
+    else
+    {
+        m_limit = m_maxLimit ? m_maxLimit : std::numeric_limits<uint32_t>::max();
+    }
+}
+
+bool execq::impl::ConcurrencyLimiter::tryAcquire()
+{
+    uint32_t inFlight = m_inFlight.load();
+    do
+    {
+        if (inFlight >= m_limit.load())
+        {
+            return false;
+        }
+    }
+    while (!m_inFlight.compare_exchange_weak(inFlight, inFlight + 1));
+    
+    return true;
+}
+
+bool execq::impl::ConcurrencyLimiter::release(const std::chrono::nanoseconds latency)
+{
+    const uint32_t inFlight = m_inFlight--;
+    if (!m_adaptive)
+    {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_windowMutex);
+    if (m_probeSkippedSamples)
+    {
+        // Tasks started before the probe ran at the higher concurrency
+        m_probeSkippedSamples--;
+        return false;
+    }
+    
+    m_windowLatencySum += static_cast<double>(latency.count());
+    m_windowSampleCount++;
+    m_windowMaxInFlight = std::max(m_windowMaxInFlight, inFlight);
+    
+    // Window of about one round of tasks at the current limit
+    if (m_windowSampleCount < std::max(m_limit.load(), kMinWindowSize))
+    {
+        return false;
+    }
+    
+    const double averageLatency = m_windowLatencySum / m_windowSampleCount;
+    const bool grown = updateLimit(averageLatency);
+    
+    m_windowLatencySum = 0;
+    m_windowSampleCount = 0;
+    m_windowMaxInFlight = 0;
+    
+    return grown;
+}
+
+bool execq::impl::ConcurrencyLimiter::adaptive() const
+{
+    return m_adaptive;
+}
+
+uint32_t execq::impl::ConcurrencyLimiter::limit() const
+{
+    return m_limit.load();
+}
+
+bool execq::impl::ConcurrencyLimiter::updateLimit(const double averageLatency)
+{
+    if (averageLatency <= 0)
+    {
+        return false;
+    }
+    
+    if (m_probeSavedLimit)
+    {
+        // Probe window ran at half of the limit: take its latency as the new baseline
+        m_minLatency = averageLatency;
+        m_limit = m_probeSavedLimit;
+        m_probeSavedLimit = 0;
+        return true;
+    }
+    
+    const uint32_t limit = m_limit.load();
+    if (++m_windowsSinceProbe >= kProbeInterval && limit > 1)
+    {
+        m_windowsSinceProbe = 0;
+        m_probeSavedLimit = limit;
+        m_probeSkippedSamples = m_inFlight.load();
+        m_limit = limit / 2;
+        return false;
+    }
+    
+    m_minLatency = m_minLatency > 0 ? std::min(m_minLatency, averageLatency) : averageLatency;
+    
+    // Tasks that wait for a resource instead of making progress: limit * (1 - minLatency / latency)
+    const double queued = limit * (1 - m_minLatency / averageLatency);
+    const double alpha = std::max(1.0, std::log10(static_cast<double>(limit)));
+    const double beta = 2 * alpha;
+    
+    if (queued > beta && limit > 1)
+    {
+        m_limit = limit - 1;
+    }
+    else if (queued < alpha && limit < m_maxLimit && m_windowMaxInFlight * 2 >= limit)
+    {
+        m_limit = limit + 1;
+        return true;
+    }
+    
+    return false;
+}
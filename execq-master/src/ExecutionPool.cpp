@@ -24,27 +24,93 @@
 
 #include "ExecutionPool.h"
 
-execq::impl::ExecutionPool::ExecutionPool(const uint32_t threadCount, const IThreadWorkerFactory& workerFactory)
+namespace
+{
+    class WorkerTaskProvider: public execq::impl::ITaskProvider
+    {
+    public:
+        WorkerTaskProvider(execq::impl::ITaskProvider& highPriorityProvider, execq::impl::ITaskProvider& provider,
+                           execq::impl::IdleWorkerStack& idleWorkers, const uint32_t workerIndex)
+        : m_highPriorityProvider(highPriorityProvider)
+        , m_provider(provider)
+        , m_idleWorkers(idleWorkers)
+        , m_workerIndex(workerIndex)
+        {}
+        
+        virtual execq::impl::Task nextTask() final
+        {
+            execq::impl::Task task = m_highPriorityProvider.nextTask();
+            if (!task.valid())
+            {
+                task = m_provider.nextTask();
+            }
+            
+            if (!task.valid())
+            {
+                // The worker parks right after. If it is woken before it parks, it just checks for tasks once more
+                m_idleWorkers.push(m_workerIndex);
+            }
+            else
+            {
+                // The worker may have been woken without being popped (notifyAllWorkers, a pending recheck).
+                // Leaving it in the stack would make notifyOneWorker hand the next task to a busy worker
+                m_idleWorkers.remove(m_workerIndex);
+            }
+            
+            return task;
+        }
+        
+    private:
+        execq::impl::ITaskProvider& m_highPriorityProvider;
+        execq::impl::ITaskProvider& m_provider;
+        execq::impl::IdleWorkerStack& m_idleWorkers;
+        const uint32_t m_workerIndex;
+    };
+}
+
+execq::impl::ExecutionPool::ExecutionPool(const uint32_t threadCount, const IThreadWorkerFactory& workerFactory, const PoolOptions& options)
+: m_overflowPolicy(options.overflowPolicy)
+, m_overflowGroup(options.maxOverflowThreads ? options.maxOverflowThreads : threadCount)
+, m_overflowWorkerFactory(m_overflowGroup)
+, m_idleWorkers(threadCount)
 {
     for (uint32_t i = 0; i < threadCount; i++)
     {
-        m_workers.emplace_back(workerFactory.createWorker(m_providerGroup));
+        m_workerProviders.emplace_back(new WorkerTaskProvider(m_highPriorityProviderGroup, m_providerGroup, m_idleWorkers, i));
+        m_workers.emplace_back(workerFactory.createWorker(*m_workerProviders.back()));
+    }
+    
+    // Workers start idle, worker #0 on top
+    for (uint32_t i = threadCount; i > 0; i--)
+    {
+        m_idleWorkers.push(i - 1);
     }
 }
 
 void execq::impl::ExecutionPool::addProvider(ITaskProvider& provider)
 {
-    m_providerGroup.addProvider(provider);
+    providerList(provider).addProvider(provider);
 }
 
 void execq::impl::ExecutionPool::removeProvider(ITaskProvider& provider)
 {
-    m_providerGroup.removeProvider(provider);
+    providerList(provider).removeProvider(provider);
 }
 
 bool execq::impl::ExecutionPool::notifyOneWorker()
 {
-    return details::NotifyWorkers(m_workers, true);
+    uint32_t index = 0;
+    while (m_idleWorkers.pop(index))
+    {
+        if (m_workers[index]->notifyWorker())
+        {
+            return true;
+        }
+    }
+    
+    // No parked workers. Busy ones check for tasks anyway when they finish the current one,
+    // the caller falls back to its additional worker
+    return false;
 }
 
 void execq::impl::ExecutionPool::notifyAllWorkers()
@@ -52,6 +118,39 @@ void execq::impl::ExecutionPool::notifyAllWorkers()
     details::NotifyWorkers(m_workers, false);
 }
 
+const execq::impl::IThreadWorkerFactory& execq::impl::ExecutionPool::additionalWorkerFactory()
+{
+    if (m_overflowPolicy == OverflowPolicy::DedicatedThread)
+    {
+        return *IThreadWorkerFactory::defaultFactory();
+    }
+    
+    return m_overflowWorkerFactory;
+}
+
+execq::impl::TimerWheel& execq::impl::ExecutionPool::timerWheel()
+{
+    return m_timerWheel;
+}
+
+// Private
+
+execq::impl::TaskProviderList& execq::impl::ExecutionPool::providerList(const ITaskProvider& provider)
+{
+    return provider.schedulingOptions().priority == Priority::High ? m_highPriorityProviderGroup : m_providerGroup;
+}
+
+// OverflowWorkerFactory
+
+execq::impl::ExecutionPool::OverflowWorkerFactory::OverflowWorkerFactory(OverflowWorkerGroup& group)
+: m_group(group)
+{}
+
+std::unique_ptr<execq::impl::IThreadWorker> execq::impl::ExecutionPool::OverflowWorkerFactory::createWorker(ITaskProvider& provider) const
+{
+    return m_group.createWorker(provider);
+}
+
 // Details
 
 bool execq::impl::details::NotifyWorkers(const std::vector<std::unique_ptr<IThreadWorker>>& workers, const bool single)
@@ -26,8 +26,11 @@
 
 execq::impl::ExecutionStream::ExecutionStream(std::shared_ptr<IExecutionPool> executionPool,
                                               const IThreadWorkerFactory& workerFactory,
-                                              std::function<void(const std::atomic_bool& isCanceled)> executee)
-: m_executionPool(executionPool)
+                                              std::function<void(const std::atomic_bool& isCanceled)> executee,
+                                              const StreamOptions& options)
+: ITaskProvider(options.scheduling)
+, m_concurrencyLimiter(options.maxConcurrency, options.adaptiveConcurrency)
+, m_executionPool(executionPool)
 , m_executee(std::move(executee))
 , m_additionalWorker(workerFactory.createWorker(*this))
 {
@@ -46,6 +49,7 @@ execq::impl::ExecutionStream::~ExecutionStream()
 void execq::impl::ExecutionStream::start()
 {
     m_stopped = false;
+    markReady();
     m_executionPool->notifyAllWorkers();
     m_additionalWorker->notifyWorker();
 }
@@ -55,22 +59,28 @@ void execq::impl::ExecutionStream::stop()
     m_stopped = true;
 }
 
+uint64_t execq::impl::ExecutionStream::servedTaskCount() const
+{
+    return ITaskProvider::servedTaskCount();
+}
+
 // IThreadWorkerPoolTaskProvider
 
 execq::impl::Task execq::impl::ExecutionStream::nextTask()
 {
-    if (m_stopped)
+    if (m_stopped || !acquireTaskSlot())
     {
         return Task();
     }
     
     m_tasksRunningCount++;
     return Task([&] {
-        m_executee(m_stopped);
+        execute();
         m_tasksRunningCount--;
         
         if (!m_tasksRunningCount)
         {
+            std::lock_guard<std::mutex> lock(m_taskCompleteMutex);
             m_taskCompleteCondition.notify_all();
         }
     });
@@ -78,6 +88,46 @@ execq::impl::Task execq::impl::ExecutionStream::nextTask()
 
 // Private
 
+bool execq::impl::ExecutionStream::acquireTaskSlot()
+{
+    if (m_concurrencyLimiter.tryAcquire())
+    {
+        return true;
+    }
+    
+    // Retry after raising the flag: either the retry sees a released slot or the releasing task sees the flag
+    m_throttled = true;
+    return m_concurrencyLimiter.tryAcquire();
+}
+
+void execq::impl::ExecutionStream::execute()
+{
+    const bool measured = m_concurrencyLimiter.adaptive();
+    const auto start = measured ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    
+    try
+    {
+        m_executee(m_stopped);
+    }
+    catch (...)
+    {
+        // There is no one to report to: stream tasks have no futures
+    }
+    
+    const auto latency = measured ? std::chrono::steady_clock::now() - start : std::chrono::nanoseconds(0);
+    const bool limitGrown = m_concurrencyLimiter.release(std::chrono::duration_cast<std::chrono::nanoseconds>(latency));
+    
+    // Workers turned away by the limiter dropped the stream from their round: bring it back
+    if (m_throttled.exchange(false))
+    {
+        markReady();
+    }
+    if (limitGrown && !m_stopped)
+    {
+        m_executionPool->notifyOneWorker();
+    }
+}
+
 void execq::impl::ExecutionStream::waitPendingTasks()
 {
     std::unique_lock<std::mutex> lock(m_taskCompleteMutex);
@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IdleWorkerStack.h"
+
+namespace
+{
+    const uint32_t kNoWorker = UINT32_MAX;
+}
+
+execq::impl::IdleWorkerStack::IdleWorkerStack(const uint32_t capacity)
+: m_top(kNoWorker)
+, m_prev(new uint32_t[capacity])
+, m_next(new uint32_t[capacity])
+, m_inStack(new std::atomic_bool[capacity])
+{
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        m_prev[i] = kNoWorker;
+        m_next[i] = kNoWorker;
+        m_inStack[i] = false;
+    }
+}
+
+void execq::impl::IdleWorkerStack::push(const uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_inStack[index])
+    {
+        if (m_top == index)
+        {
+            return;
+        }
+        unlink(index);
+    }
+    
+    m_prev[index] = kNoWorker;
+    m_next[index] = m_top;
+    if (m_top != kNoWorker)
+    {
+        m_prev[m_top] = index;
+    }
+    m_top = index;
+    m_inStack[index] = true;
+    m_size++;
+}
+
+bool execq::impl::IdleWorkerStack::pop(uint32_t& index)
+{
+    // Common case when the pool is saturated
+    if (m_size == 0)
+    {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_top == kNoWorker)
+    {
+        return false;
+    }
+    
+    index = m_top;
+    unlink(index);
+    return true;
+}
+
+void execq::impl::IdleWorkerStack::remove(const uint32_t index)
+{
+    // Called for every task taken: only the worker itself pushes its index, so a clear flag can't be set concurrently
+    if (!m_inStack[index].load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_inStack[index])
+    {
+        unlink(index);
+    }
+}
+
+// Private
+
+void execq::impl::IdleWorkerStack::unlink(const uint32_t index)
+{
+    const uint32_t prev = m_prev[index];
+    const uint32_t next = m_next[index];
+    if (prev != kNoWorker)
+    {
+        m_next[prev] = next;
+    }
+    else
+    {
+        m_top = next;
+    }
+    if (next != kNoWorker)
+    {
+        m_prev[next] = prev;
+    }
+    
+    m_prev[index] = kNoWorker;
+    m_next[index] = kNoWorker;
+    m_inStack[index] = false;
+    m_size--;
+}
@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "OverflowWorkerGroup.h"
+
+#include <algorithm>
+
+namespace execq
+{
+    namespace impl
+    {
+        class OverflowWorker: public IThreadWorker
+        {
+        public:
+            OverflowWorker(OverflowWorkerGroup& group, ITaskProvider& provider);
+            virtual ~OverflowWorker();
+            
+            virtual bool notifyWorker() final;
+            
+        private:
+            friend class OverflowWorkerGroup;
+            OverflowWorkerGroup& m_group;
+            ITaskProvider& m_provider;
+            
+            // Guarded by the group mutex
+            bool m_scheduled = false;
+            uint32_t m_activeThreadCount = 0;
+        };
+    }
+}
+
+execq::impl::OverflowWorker::OverflowWorker(OverflowWorkerGroup& group, ITaskProvider& provider)
+: m_group(group)
+, m_provider(provider)
+{}
+
+execq::impl::OverflowWorker::~OverflowWorker()
+{
+    m_group.unschedule(*this);
+}
+
+bool execq::impl::OverflowWorker::notifyWorker()
+{
+    return m_group.schedule(*this);
+}
+
+execq::impl::OverflowWorkerGroup::OverflowWorkerGroup(const uint32_t maxThreadCount)
+: m_maxThreadCount(maxThreadCount)
+{}
+
+execq::impl::OverflowWorkerGroup::~OverflowWorkerGroup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shouldQuit = true;
+        m_condition.notify_all();
+    }
+    
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+std::unique_ptr<execq::impl::IThreadWorker> execq::impl::OverflowWorkerGroup::createWorker(ITaskProvider& provider)
+{
+    return std::unique_ptr<IThreadWorker>(new OverflowWorker(*this, provider));
+}
+
+size_t execq::impl::OverflowWorkerGroup::threadCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_threads.size();
+}
+
+bool execq::impl::OverflowWorkerGroup::schedule(OverflowWorker& worker)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (worker.m_scheduled || m_shouldQuit)
+    {
+        return false;
+    }
+    
+    worker.m_scheduled = true;
+    m_pendingWorkers.push_back(&worker);
+    
+    if (m_pendingWorkers.size() > m_idleThreadCount && m_threads.size() < m_maxThreadCount)
+    {
+        m_threads.emplace_back(&OverflowWorkerGroup::threadMain, this);
+    }
+    else
+    {
+        m_condition.notify_one();
+    }
+    
+    return true;
+}
+
+void execq::impl::OverflowWorkerGroup::unschedule(OverflowWorker& worker)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (worker.m_activeThreadCount > 0)
+    {
+        m_workerReleasedCondition.wait(lock);
+    }
+    
+    if (worker.m_scheduled)
+    {
+        m_pendingWorkers.erase(std::find(m_pendingWorkers.begin(), m_pendingWorkers.end(), &worker));
+    }
+}
+
+void execq::impl::OverflowWorkerGroup::threadMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_shouldQuit)
+    {
+        if (m_pendingWorkers.empty())
+        {
+            m_idleThreadCount++;
+            m_condition.wait(lock);
+            m_idleThreadCount--;
+            continue;
+        }
+        
+        OverflowWorker* worker = m_pendingWorkers.front();
+        m_pendingWorkers.pop_front();
+        worker->m_scheduled = false;
+        worker->m_activeThreadCount++;
+        lock.unlock();
+        
+        Task task = worker->m_provider.nextTask();
+        const bool hadTask = task.valid();
+        if (hadTask)
+        {
+            task();
+        }
+        
+        lock.lock();
+        worker->m_activeThreadCount--;
+        
+        // The provider may have more work: come back to it after the others waiting in line
+        if (hadTask && !worker->m_scheduled)
+        {
+            worker->m_scheduled = true;
+            m_pendingWorkers.push_back(worker);
+            if (m_idleThreadCount)
+            {
+                m_condition.notify_one();
+            }
+        }
+        
+        if (!worker->m_activeThreadCount)
+        {
+            m_workerReleasedCondition.notify_all();
+        }
+    }
+}
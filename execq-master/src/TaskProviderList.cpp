@@ -22,29 +22,118 @@
  * SOFTWARE.
  */
 
-#include <algorithm>
 #include "TaskProviderList.h"
 
+#include <algorithm>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    // Indices into TaskProviderList::Chunk::bits
+    const size_t kReadyBits = 0;
+    const size_t kSignaledBits = 1;
+    
+    size_t LowestSetBit(const uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return static_cast<size_t>(__builtin_ctzll(value));
+#endif
+    }
+    
+    size_t CurrentThreadIndex()
+    {
+        static std::atomic<size_t> s_nextIndex { 0 };
+        thread_local const size_t t_index = s_nextIndex++;
+        return t_index;
+    }
+}
+
+execq::impl::ITaskProvider::ITaskProvider(const SchedulingOptions& schedulingOptions)
+: m_schedulingOptions(schedulingOptions)
+{}
+
+const execq::SchedulingOptions& execq::impl::ITaskProvider::schedulingOptions() const
+{
+    return m_schedulingOptions;
+}
+
+uint64_t execq::impl::ITaskProvider::servedTaskCount() const
+{
+    return m_servedTaskCount.load(std::memory_order_relaxed);
+}
+
+void execq::impl::ITaskProvider::markReady()
+{
+    std::atomic<uint64_t>* const bits = m_readyBits.load();
+    if (bits)
+    {
+        // 'signaled' first: a worker that clears 'ready' after this call must see 'signaled' and restore 'ready'
+        bits[kSignaledBits].fetch_or(m_readyMask);
+        bits[kReadyBits].fetch_or(m_readyMask);
+    }
+}
+
+execq::impl::TaskProviderList::~TaskProviderList()
+{
+    Chunk* chunk = m_head.load();
+    while (chunk)
+    {
+        Chunk* const next = chunk->next.load();
+        delete chunk;
+        chunk = next;
+    }
+}
+
 execq::impl::Task execq::impl::TaskProviderList::nextTask()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    Cursor& cursor = m_cursors[CurrentThreadIndex() % kCursorCount];
+    Chunk* chunk = cursor.chunk.load(std::memory_order_relaxed);
+    size_t index = cursor.index.load(std::memory_order_relaxed);
+    if (!chunk)
+    {
+        chunk = m_head.load();
+        index = 0;
+    }
     
-    const size_t taskProvidersCount = m_taskProviders.size();
-    const auto listEndIt = m_taskProviders.end();
+    Chunk* const startChunk = chunk;
+    const size_t startIndex = index;
     
-    for (size_t i = 0; i < taskProvidersCount; i++)
+    // One extra round comes back to the first chunk to check providers before the cursor
+    const size_t chunkCount = m_chunkCount.load();
+    for (size_t i = 0; chunk && i <= chunkCount; i++)
     {
-        if (m_currentTaskProviderIt == listEndIt)
+        uint64_t ready = index < kChunkSize ? chunk->bits[kReadyBits].load() & (~uint64_t(0) << index) : 0;
+        while (ready)
         {
-            m_currentTaskProviderIt = m_taskProviders.begin();
+            const size_t readyIndex = LowestSetBit(ready);
+            ready &= ready - 1;
+            
+            Task task = tryProvider(*chunk, readyIndex);
+            if (task.valid())
+            {
+                // Stay on the provider until it has used its quantum of 'weight' tasks
+                const bool sameProvider = chunk == startChunk && readyIndex == startIndex;
+                const uint32_t served = sameProvider ? cursor.served.load(std::memory_order_relaxed) + 1 : 1;
+                const bool quantumUsed = served >= chunk->slots[readyIndex].weight.load(std::memory_order_relaxed);
+                
+                cursor.chunk.store(chunk, std::memory_order_relaxed);
+                cursor.index.store(quantumUsed ? readyIndex + 1 : readyIndex, std::memory_order_relaxed);
+                cursor.served.store(quantumUsed ? 0 : served, std::memory_order_relaxed);
+                return task;
+            }
         }
         
-        ITaskProvider* const provider = *(m_currentTaskProviderIt++);
-        Task task = provider->nextTask();
-        if (task.valid())
-        {
-            return task;
-        }
+        Chunk* const next = chunk->next.load();
+        chunk = next ? next : m_head.load();
+        index = 0;
     }
     
     return Task();
@@ -53,17 +142,114 @@ execq::impl::Task execq::impl::TaskProviderList::nextTask()
 void execq::impl::TaskProviderList::addProvider(ITaskProvider& provider)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_taskProviders.push_back(&provider);
-    m_currentTaskProviderIt = m_taskProviders.begin();
+    if (m_freeSlots.empty())
+    {
+        Chunk* const chunk = new Chunk;
+        chunk->bits[kReadyBits] = 0;
+        chunk->bits[kSignaledBits] = 0;
+        for (size_t i = kChunkSize; i > 0; i--)
+        {
+            m_freeSlots.emplace_back(chunk, i - 1);
+        }
+        
+        if (m_tail)
+        {
+            m_tail->next = chunk;
+        }
+        else
+        {
+            m_head = chunk;
+        }
+        m_tail = chunk;
+        m_chunkCount++;
+    }
+    
+    Chunk* const chunk = m_freeSlots.back().first;
+    const size_t index = m_freeSlots.back().second;
+    m_freeSlots.pop_back();
+    
+    const uint64_t mask = uint64_t(1) << index;
+    chunk->slots[index].weight = std::max<uint32_t>(provider.schedulingOptions().weight, 1);
+    chunk->slots[index].provider = &provider;
+    provider.m_readyMask = mask;
+    provider.m_readyBits = chunk->bits;
+    chunk->bits[kReadyBits].fetch_or(mask);
 }
 
 void execq::impl::TaskProviderList::removeProvider(ITaskProvider& provider)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    const auto it = std::find(m_taskProviders.begin(), m_taskProviders.end(), &provider);
-    if (it != m_taskProviders.end())
+    
+    std::atomic<uint64_t>* const bits = provider.m_readyBits.load();
+    Chunk* chunk = m_head.load();
+    while (chunk && chunk->bits != bits)
     {
-        m_taskProviders.erase(it);
-        m_currentTaskProviderIt = m_taskProviders.begin();
+        chunk = chunk->next.load();
     }
+    if (!chunk)
+    {
+        return;
+    }
+    
+    const uint64_t mask = provider.m_readyMask;
+    Slot& slot = chunk->slots[LowestSetBit(mask)];
+    
+    provider.m_readyBits = nullptr;
+    slot.provider = nullptr;
+    chunk->bits[kReadyBits].fetch_and(~mask);
+    chunk->bits[kSignaledBits].fetch_and(~mask);
+    
+    // Wait for workers that picked the provider before it was unlinked
+    while (slot.pins > 0)
+    {
+        std::this_thread::yield();
+    }
+    
+    m_freeSlots.emplace_back(chunk, LowestSetBit(mask));
+}
+
+execq::impl::Task execq::impl::TaskProviderList::tryProvider(Chunk& chunk, const size_t index)
+{
+    const uint64_t mask = uint64_t(1) << index;
+    Slot& slot = chunk.slots[index];
+    
+    Task task;
+    slot.pins++;
+    ITaskProvider* const provider = slot.provider.load();
+    if (provider)
+    {
+        if (chunk.bits[kSignaledBits].load() & mask)
+        {
+            chunk.bits[kSignaledBits].fetch_and(~mask);
+        }
+        
+        task = provider->nextTask();
+        if (task.valid())
+        {
+            provider->m_servedTaskCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            // Provider is drained. If it was marked ready during the call, the new task may have been missed
+            chunk.bits[kReadyBits].fetch_and(~mask);
+            if (chunk.bits[kSignaledBits].load() & mask)
+            {
+                chunk.bits[kReadyBits].fetch_or(mask);
+            }
+        }
+    }
+    else
+    {
+        // Slot is free. A 'markReady' that loaded the bits before 'removeProvider' may have set them again:
+        // clear them so workers stop scanning the slot, unless a new provider took it meanwhile
+        chunk.bits[kSignaledBits].fetch_and(~mask);
+        chunk.bits[kReadyBits].fetch_and(~mask);
+        if (slot.provider.load())
+        {
+            chunk.bits[kReadyBits].fetch_or(mask);
+        }
+    }
+    slot.pins--;
+    
+    return task;
 }
@@ -0,0 +1,284 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+execq::impl::TimerWheel::TimerWheel(const Clock::duration tick, const uint32_t slotCount)
+: m_tick(tick)
+, m_startTime(Clock::now())
+, m_slots(slotCount, nullptr)
+{}
+
+execq::impl::TimerWheel::~TimerWheel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shouldQuit = true;
+        m_condition.notify_all();
+    }
+    
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    
+    for (Timer* timer : m_slots)
+    {
+        while (timer)
+        {
+            std::unique_ptr<Timer> deleted(timer);
+            timer = timer->m_next;
+        }
+    }
+}
+
+execq::impl::TimerWheel& execq::impl::TimerWheel::defaultWheel()
+{
+    static TimerWheel s_wheel;
+    return s_wheel;
+}
+
+void execq::impl::TimerWheel::schedule(std::unique_ptr<Timer> timer, const Clock::time_point dueTime)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable())
+    {
+        m_thread = std::thread(&TimerWheel::threadMain, this);
+    }
+    
+    // Never earlier than the tick the wheel processes next
+    const uint64_t dueTick = std::max(tickAt(dueTime), m_nextTick);
+    timer->m_dueTick = dueTick;
+    link(timer.release(), m_slots[dueTick % m_slots.size()]);
+    
+    if (dueTick < m_wakeTick)
+    {
+        m_condition.notify_one();
+    }
+}
+
+void execq::impl::TimerWheel::expire(const void* owner)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Timer* expired = nullptr;
+    const auto it = m_ownerTimers.find(owner);
+    if (it != m_ownerTimers.end())
+    {
+        Timer* timer = it->second;
+        m_ownerTimers.erase(it);
+        while (timer)
+        {
+            Timer* const next = timer->m_ownerNext;
+            *timer->m_link = timer->m_next;
+            if (timer->m_next)
+            {
+                timer->m_next->m_link = timer->m_link;
+            }
+            m_pendingCount--;
+            
+            // Owner list is newest first: reversed back to scheduling order
+            timer->m_next = expired;
+            expired = timer;
+            timer = next;
+        }
+    }
+    
+    // Timers of the owner may be in the batch being fired by the wheel thread. Not waited when called from that batch
+    if (m_isFiring && std::this_thread::get_id() != m_thread.get_id())
+    {
+        const uint64_t firingBatch = m_firedBatchCount;
+        while (m_firedBatchCount == firingBatch)
+        {
+            m_firedCondition.wait(lock);
+        }
+    }
+    
+    lock.unlock();
+    fireTimers(expired);
+}
+
+size_t execq::impl::TimerWheel::pendingCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingCount;
+}
+
+// Private
+
+void execq::impl::TimerWheel::threadMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_shouldQuit)
+    {
+        uint64_t wakeTick = 0;
+        if (!nextPendingTick(wakeTick))
+        {
+            m_wakeTick = UINT64_MAX;
+            m_condition.wait(lock);
+            continue;
+        }
+        
+        m_wakeTick = wakeTick;
+        const Clock::time_point wakeTime = m_startTime + m_tick * wakeTick;
+        if (Clock::now() < wakeTime)
+        {
+            // Woken earlier if a timer with smaller due tick is scheduled
+            m_condition.wait_until(lock, wakeTime);
+            continue;
+        }
+        
+        Timer* const due = unlinkDueTimers(tickAt(Clock::now()));
+        m_isFiring = true;
+        lock.unlock();
+        
+        fireTimers(due);
+        
+        lock.lock();
+        m_isFiring = false;
+        m_firedBatchCount++;
+        m_firedCondition.notify_all();
+    }
+}
+
+uint64_t execq::impl::TimerWheel::tickAt(const Clock::time_point time) const
+{
+    if (time <= m_startTime)
+    {
+        return 0;
+    }
+    
+    // Rounded up: timers never fire before their time
+    const Clock::duration elapsed = time - m_startTime;
+    return static_cast<uint64_t>((elapsed + m_tick - Clock::duration(1)) / m_tick);
+}
+
+bool execq::impl::TimerWheel::nextPendingTick(uint64_t& tick) const
+{
+    if (m_pendingCount == 0)
+    {
+        return false;
+    }
+    
+    // The first non-empty slot in a turn of the wheel. Its timers may be due in one of next turns, then the thread just wakes once more
+    const size_t slotCount = m_slots.size();
+    for (size_t i = 0; i < slotCount; i++)
+    {
+        if (m_slots[(m_nextTick + i) % slotCount])
+        {
+            tick = m_nextTick + i;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+execq::impl::TimerWheel::Timer* execq::impl::TimerWheel::unlinkDueTimers(const uint64_t currentTick)
+{
+    Timer* due = nullptr;
+    Timer** dueTail = &due;
+    
+    const size_t slotCount = m_slots.size();
+    const uint64_t lastTick = std::min<uint64_t>(currentTick, m_nextTick + slotCount - 1);
+    for (uint64_t tick = m_nextTick; tick <= lastTick; tick++)
+    {
+        Timer* timer = m_slots[tick % slotCount];
+        while (timer)
+        {
+            Timer* const next = timer->m_next;
+            if (timer->m_dueTick <= currentTick)
+            {
+                unlink(timer);
+                timer->m_next = nullptr;
+                *dueTail = timer;
+                dueTail = &timer->m_next;
+            }
+            timer = next;
+        }
+    }
+    
+    m_nextTick = currentTick + 1;
+    return due;
+}
+
+void execq::impl::TimerWheel::link(Timer* timer, Timer*& slot)
+{
+    timer->m_next = slot;
+    timer->m_link = &slot;
+    if (slot)
+    {
+        slot->m_link = &timer->m_next;
+    }
+    slot = timer;
+    
+    // Map nodes are stable, so timers may point to the head of the owner list
+    Timer*& ownerTimers = m_ownerTimers[timer->owner()];
+    timer->m_ownerNext = ownerTimers;
+    timer->m_ownerLink = &ownerTimers;
+    if (ownerTimers)
+    {
+        ownerTimers->m_ownerLink = &timer->m_ownerNext;
+    }
+    ownerTimers = timer;
+    
+    m_pendingCount++;
+}
+
+void execq::impl::TimerWheel::unlink(Timer* timer)
+{
+    *timer->m_link = timer->m_next;
+    if (timer->m_next)
+    {
+        timer->m_next->m_link = timer->m_link;
+    }
+    
+    *timer->m_ownerLink = timer->m_ownerNext;
+    if (timer->m_ownerNext)
+    {
+        timer->m_ownerNext->m_ownerLink = timer->m_ownerLink;
+    }
+    else
+    {
+        // The last timer of the owner list: drop the owner if it was the only one
+        const auto it = m_ownerTimers.find(timer->owner());
+        if (&it->second == timer->m_ownerLink)
+        {
+            m_ownerTimers.erase(it);
+        }
+    }
+    
+    m_pendingCount--;
+}
+
+void execq::impl::TimerWheel::fireTimers(Timer* timers)
+{
+    while (timers)
+    {
+        std::unique_ptr<Timer> timer(timers);
+        timers = timer->m_next;
+        timer->fire();
+    }
+}
@@ -36,18 +36,18 @@ namespace
         return hardwareThreadCount ? hardwareThreadCount : defaultThreadCount;
     }
     
-    std::shared_ptr<execq::IExecutionPool> CreateDefaultExecutionPool(const uint32_t threadCount)
+    std::shared_ptr<execq::IExecutionPool> CreateDefaultExecutionPool(const uint32_t threadCount, const execq::PoolOptions& options)
     {
-        return std::make_shared<execq::impl::ExecutionPool>(threadCount, *execq::impl::IThreadWorkerFactory::defaultFactory());
+        return std::make_shared<execq::impl::ExecutionPool>(threadCount, *execq::impl::IThreadWorkerFactory::defaultFactory(), options);
     }
 }
 
-std::shared_ptr<execq::IExecutionPool> execq::CreateExecutionPool()
+std::shared_ptr<execq::IExecutionPool> execq::CreateExecutionPool(const PoolOptions& options)
 {
-    return CreateDefaultExecutionPool(GetOptimalThreadCount());
+    return CreateDefaultExecutionPool(GetOptimalThreadCount(), options);
 }
 
-std::shared_ptr<execq::IExecutionPool> execq::CreateExecutionPool(const uint32_t threadCount)
+std::shared_ptr<execq::IExecutionPool> execq::CreateExecutionPool(const uint32_t threadCount, const PoolOptions& options)
 {
     if (!threadCount)
     {
@@ -58,13 +58,15 @@ std::shared_ptr<execq::IExecutionPool> execq::CreateExecutionPool(const uint32_t
         throw std::runtime_error("Failed to create IExecutionPool: for single-thread execution use pool-independent serial queue.");
     }
     
-    return CreateDefaultExecutionPool(threadCount);
+    return CreateDefaultExecutionPool(threadCount, options);
 }
 
 std::unique_ptr<execq::IExecutionStream> execq::CreateExecutionStream(std::shared_ptr<IExecutionPool> executionPool,
-                                                                      std::function<void(const std::atomic_bool& isCanceled)> executee)
+                                                                      std::function<void(const std::atomic_bool& isCanceled)> executee,
+                                                                      const StreamOptions& options)
 {
     return std::unique_ptr<impl::ExecutionStream>(new impl::ExecutionStream(executionPool,
-                                                                            *impl::IThreadWorkerFactory::defaultFactory(),
-                                                                            std::move(executee)));
+                                                                            executionPool->additionalWorkerFactory(),
+                                                                            std::move(executee),
+                                                                            options));
 }
@@ -0,0 +1,193 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "execq.h"
+#include "ExecqTestUtil.h"
+
+using namespace execq::test;
+
+TEST(BatchExecutionQueue, CoalescesPendingObjects)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    execq::BatchOptions options;
+    options.maxBatchSize = 3;
+    
+    std::promise<void> firstBatchGate;
+    std::shared_future<void> firstBatchCanFinish = firstBatchGate.get_future().share();
+    std::vector<std::vector<int>> batches;
+    
+    auto queue = execq::CreateBatchExecutionQueue<int, int>(pool, [&] (const std::atomic_bool&, std::vector<int>& objects, std::vector<std::promise<int>>& promises) {
+        ASSERT_EQ(objects.size(), promises.size());
+        if (batches.empty())
+        {
+            firstBatchCanFinish.wait();
+        }
+        
+        batches.push_back(objects);
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            promises[i].set_value(objects[i] * 10);
+        }
+    }, options);
+    
+    // Objects pushed while the first batch runs are coalesced into batches of 'maxBatchSize'
+    std::vector<std::future<int>> results;
+    results.push_back(queue->push(0));
+    WaitForLongTermJob();
+    for (int i = 1; i <= 5; i++)
+    {
+        results.push_back(queue->push(i));
+    }
+    firstBatchGate.set_value();
+    
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        ASSERT_TRUE(results[i].wait_for(kTimeout) == std::future_status::ready);
+        EXPECT_EQ(results[i].get(), static_cast<int>(i) * 10);
+    }
+    
+    EXPECT_EQ(batches, std::vector<std::vector<int>>({ { 0 }, { 1, 2, 3 }, { 4, 5 } }));
+}
+
+TEST(BatchExecutionQueue, WaitsForMaxDelay)
+{
+    execq::BatchOptions options;
+    options.maxBatchSize = 100;
+    options.maxDelay = std::chrono::duration_cast<std::chrono::microseconds>(kLongTermJob);
+    
+    std::vector<size_t> batchSizes;
+    auto queue = execq::CreateBatchExecutionQueue<void, int>([&] (const std::atomic_bool&, std::vector<int>& objects, std::vector<std::promise<void>>& promises) {
+        batchSizes.push_back(objects.size());
+        for (auto& promise : promises)
+        {
+            promise.set_value();
+        }
+    }, options);
+    
+    // All objects pushed within 'maxDelay' go into one batch
+    std::future<void> last;
+    for (int i = 0; i < 10; i++)
+    {
+        last = queue->push(i);
+    }
+    ASSERT_TRUE(last.wait_for(kTimeout) == std::future_status::ready);
+    
+    EXPECT_EQ(batchSizes, std::vector<size_t>({ 10 }));
+}
+
+TEST(BatchExecutionQueue, ExecutorThrows)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    std::promise<void> gate;
+    std::shared_future<void> canStart = gate.get_future().share();
+    auto queue = execq::CreateBatchExecutionQueue<int, int>(pool, [&] (const std::atomic_bool&, std::vector<int>& objects, std::vector<std::promise<int>>& promises) {
+        canStart.wait();
+        if (objects[0] == 1)
+        {
+            promises[0].set_value(1);
+        }
+        throw std::runtime_error("batch failed");
+    });
+    
+    std::future<int> first = queue->push(1);
+    std::future<int> second = queue->push(2);
+    gate.set_value();
+    
+    // Promises satisfied by the executor keep their values, the rest get the exception
+    ASSERT_TRUE(first.wait_for(kTimeout) == std::future_status::ready);
+    ASSERT_TRUE(second.wait_for(kTimeout) == std::future_status::ready);
+    EXPECT_NO_THROW(first.get());
+    EXPECT_THROW(second.get(), std::runtime_error);
+}
+
+TEST(BatchExecutionQueue, CancelSplitsBatches)
+{
+    auto executionPool = std::make_shared<::testing::NiceMock<MockExecutionPool>>();
+    MockThreadWorkerFactory workerFactory {};
+    
+    execq::impl::ITaskProvider* registeredProvider = nullptr;
+    EXPECT_CALL(*executionPool, addProvider(SaveArgAddress(&registeredProvider)))
+    .WillOnce(::testing::Return());
+    ON_CALL(*executionPool, notifyOneWorker())
+    .WillByDefault(::testing::Return(true));
+    
+    EXPECT_CALL(workerFactory, createWorker(::testing::_))
+    .WillOnce(::testing::Return(::testing::ByMove(std::unique_ptr<MockThreadWorker>(new ::testing::NiceMock<MockThreadWorker>{}))));
+    
+    std::vector<std::pair<bool, std::vector<std::string>>> batches;
+    execq::impl::BatchExecutionQueue<void, std::string> queue(executionPool, workerFactory, [&] (const std::atomic_bool& isCanceled,
+                                                                                                  std::vector<std::string>& objects,
+                                                                                                  std::vector<std::promise<void>>& promises) {
+        batches.emplace_back(isCanceled.load(), objects);
+        for (auto& promise : promises)
+        {
+            promise.set_value();
+        }
+    });
+    ASSERT_NE(registeredProvider, nullptr);
+    
+    queue.push("a");
+    queue.push("b");
+    queue.cancel();
+    queue.push("c");
+    
+    // Only one batch may be in flight
+    execq::impl::Task task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    EXPECT_FALSE(registeredProvider->nextTask().valid());
+    task();
+    
+    task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    
+    EXPECT_FALSE(registeredProvider->nextTask().valid());
+    
+    ASSERT_EQ(batches.size(), 2);
+    EXPECT_EQ(batches[0], std::make_pair(true, std::vector<std::string>({ "a", "b" })));
+    EXPECT_EQ(batches[1], std::make_pair(false, std::vector<std::string>({ "c" })));
+}
+
+TEST(BatchExecutionQueue, PushAfter)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    auto queue = execq::CreateBatchExecutionQueue<std::chrono::steady_clock::time_point, int>(pool, [] (const std::atomic_bool& isCanceled, std::vector<int>&, std::vector<std::promise<std::chrono::steady_clock::time_point>>& promises) {
+        EXPECT_FALSE(isCanceled);
+        for (auto& promise : promises)
+        {
+            promise.set_value(std::chrono::steady_clock::now());
+        }
+    });
+    
+    const auto pushTime = std::chrono::steady_clock::now();
+    auto delayed = queue->pushAfter(kLongTermJob, 1);
+    auto immediate = queue->push(0);
+    
+    ASSERT_EQ(delayed.wait_for(kTimeout), std::future_status::ready);
+    EXPECT_LT(immediate.get(), pushTime + kLongTermJob);
+    EXPECT_GE(delayed.get(), pushTime + kLongTermJob);
+}
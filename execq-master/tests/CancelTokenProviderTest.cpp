@@ -30,21 +30,84 @@ TEST(ExecutionPool, CancelTokenProvider)
 {
     execq::impl::CancelTokenProvider provider;
     
-    execq::impl::CancelToken token = provider.token();
-    ASSERT_NE(token, nullptr);
+    const execq::impl::CancelToken token = provider.token();
     
     // be default, token is not canceled
-    EXPECT_FALSE(token->load());
+    EXPECT_FALSE(provider.isCanceled(token));
     
     provider.cancel();
     
     // both old and current provider's token are canceled
-    EXPECT_TRUE(token->load());
-    EXPECT_TRUE(provider.token()->load());
+    EXPECT_TRUE(provider.isCanceled(token));
+    EXPECT_TRUE(provider.isCanceled(provider.token()));
     
     provider.cancelAndRenew();
     
     // old token is canceled, current provider's token is not
-    EXPECT_TRUE(token->load());
-    EXPECT_FALSE(provider.token()->load());
+    EXPECT_TRUE(provider.isCanceled(token));
+    EXPECT_FALSE(provider.isCanceled(provider.token()));
+    EXPECT_NE(token, provider.token());
+}
+
+TEST(ExecutionPool, CancelTokenProvider_Flag)
+{
+    execq::impl::CancelTokenProvider provider;
+    
+    const execq::impl::CancelToken token = provider.token();
+    execq::impl::CancelFlag flag(provider, token);
+    EXPECT_FALSE(flag.get());
+    
+    // flag follows cancel while it is alive
+    provider.cancelAndRenew();
+    EXPECT_TRUE(flag.get());
+    
+    execq::impl::CancelFlag currentFlag(provider, provider.token());
+    EXPECT_FALSE(currentFlag.get());
+}
+
+TEST(ExecutionPool, CancelTokenProvider_ManyGenerations)
+{
+    execq::impl::CancelTokenProvider provider;
+    
+    const execq::impl::CancelToken token = provider.token();
+    const execq::impl::CancelFlag flag(provider, token);
+    
+    // flag slots are reused, but never the one in use
+    for (int i = 0; i < 100; i++)
+    {
+        const execq::impl::CancelToken oldToken = provider.token();
+        provider.cancelAndRenew();
+        
+        EXPECT_TRUE(provider.isCanceled(oldToken));
+        EXPECT_TRUE(execq::impl::CancelFlag(provider, oldToken).get());
+        EXPECT_FALSE(provider.isCanceled(provider.token()));
+        EXPECT_FALSE(execq::impl::CancelFlag(provider, provider.token()).get());
+        EXPECT_TRUE(flag.get());
+        EXPECT_TRUE(provider.isCanceled(token));
+    }
+}
+
+TEST(ExecutionPool, CancelTokenProvider_AllSlotsInUse)
+{
+    execq::impl::CancelTokenProvider provider;
+    
+    // Each generation has a running task: renew does not wait for any of them
+    std::vector<std::unique_ptr<execq::impl::CancelFlag>> flags;
+    for (int i = 0; i < 20; i++)
+    {
+        flags.emplace_back(new execq::impl::CancelFlag(provider, provider.token()));
+        EXPECT_FALSE(flags.back()->get());
+        
+        provider.cancelAndRenew();
+        for (const auto& flag : flags)
+        {
+            EXPECT_TRUE(flag->get());
+        }
+        EXPECT_FALSE(provider.isCanceled(provider.token()));
+    }
+    
+    // Old flags are released once their tasks are done
+    flags.clear();
+    provider.cancelAndRenew();
+    EXPECT_FALSE(provider.isCanceled(provider.token()));
 }
@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ConcurrencyLimiter.h"
+
+#include <gmock/gmock.h>
+
+namespace
+{
+    // Runs 'rounds' rounds of the limiter against a resource that serves 'capacity' tasks at once:
+    // beyond that tasks queue up and their latency grows proportionally
+    uint32_t Simulate(execq::impl::ConcurrencyLimiter& limiter, const uint32_t capacity, const int rounds,
+                      const std::chrono::microseconds baseLatency = std::chrono::microseconds(100))
+    {
+        for (int i = 0; i < rounds; i++)
+        {
+            uint32_t running = 0;
+            while (limiter.tryAcquire())
+            {
+                running++;
+            }
+            
+            const auto latency = baseLatency * std::max(running, capacity) / capacity;
+            for (uint32_t j = 0; j < running; j++)
+            {
+                limiter.release(latency);
+            }
+        }
+        
+        return limiter.limit();
+    }
+}
+
+TEST(ConcurrencyLimiter, Unlimited)
+{
+    execq::impl::ConcurrencyLimiter limiter(0, false);
+    
+    for (int i = 0; i < 1000; i++)
+    {
+        EXPECT_TRUE(limiter.tryAcquire());
+    }
+}
+
+TEST(ConcurrencyLimiter, Fixed)
+{
+    execq::impl::ConcurrencyLimiter limiter(2, false);
+    
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_FALSE(limiter.tryAcquire());
+    
+    EXPECT_FALSE(limiter.release(std::chrono::nanoseconds(0)));
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_FALSE(limiter.tryAcquire());
+}
+
+TEST(ConcurrencyLimiter, Adaptive_GrowsWhileLatencyIsFlat)
+{
+    execq::impl::ConcurrencyLimiter limiter(32, true);
+    EXPECT_LT(limiter.limit(), 32);
+    
+    EXPECT_EQ(Simulate(limiter, 1000, 500), 32);
+}
+
+TEST(ConcurrencyLimiter, Adaptive_SettlesAtResourceCapacity)
+{
+    execq::impl::ConcurrencyLimiter limiter(64, true);
+    
+    const uint32_t limit = Simulate(limiter, 12, 2000);
+    EXPECT_GE(limit, 12);
+    EXPECT_LE(limit, 16);
+}
+
+TEST(ConcurrencyLimiter, Adaptive_ShrinksWhenResourceDegrades)
+{
+    execq::impl::ConcurrencyLimiter limiter(64, true);
+    
+    EXPECT_GE(Simulate(limiter, 24, 2000), 24);
+    
+    const uint32_t limit = Simulate(limiter, 6, 2000);
+    EXPECT_GE(limit, 6);
+    EXPECT_LE(limit, 10);
+}
+
+TEST(ConcurrencyLimiter, Adaptive_DoesNotGrowWhenUnused)
+{
+    execq::impl::ConcurrencyLimiter limiter(64, true);
+    const uint32_t initialLimit = limiter.limit();
+    
+    // Single task at a time never uses the limit
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_TRUE(limiter.tryAcquire());
+        limiter.release(std::chrono::microseconds(100));
+    }
+    
+    EXPECT_EQ(limiter.limit(), initialLimit);
+}
+
+TEST(ConcurrencyLimiter, Adaptive_FollowsBaselineChange)
+{
+    execq::impl::ConcurrencyLimiter limiter(64, true);
+    
+    EXPECT_GE(Simulate(limiter, 12, 2000), 12);
+    
+    // Same capacity, but each task is slower now: that is not congestion
+    const uint32_t limit = Simulate(limiter, 12, 2000, std::chrono::microseconds(300));
+    EXPECT_GE(limit, 12);
+    EXPECT_LE(limit, 16);
+}
@@ -54,6 +54,18 @@ namespace execq
             MOCK_METHOD0(notifyWorker, bool());
         };
         
+        class MockTaskProvider: public execq::impl::ITaskProvider
+        {
+        public:
+            MockTaskProvider() = default;
+            
+            explicit MockTaskProvider(const execq::SchedulingOptions& schedulingOptions)
+            : ITaskProvider(schedulingOptions)
+            {}
+            
+            MOCK_METHOD0(nextTask, execq::impl::Task());
+        };
+        
         static const std::chrono::milliseconds kLongTermJob { 100 };
         static const std::chrono::milliseconds kTimeout { 500 };
         
@@ -0,0 +1,360 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "execq.h"
+#include "IdleWorkerStack.h"
+#include "ExecqTestUtil.h"
+
+#include <thread>
+
+using namespace ::testing;
+using execq::test::MockTaskProvider;
+
+namespace
+{
+    class TestWorkers
+    {
+    public:
+        explicit TestWorkers(execq::test::MockThreadWorkerFactory& factory)
+        {
+            EXPECT_CALL(factory, createWorker(_))
+            .WillRepeatedly(Invoke([this] (execq::impl::ITaskProvider& provider) {
+                providers.push_back(&provider);
+                workers.push_back(new execq::test::MockThreadWorker);
+                return std::unique_ptr<execq::impl::IThreadWorker>(workers.back());
+            }));
+        }
+        
+        std::vector<execq::impl::ITaskProvider*> providers;
+        std::vector<execq::test::MockThreadWorker*> workers;
+    };
+}
+
+TEST(ExecutionPool, IdleWorkerStack_LIFO)
+{
+    execq::impl::IdleWorkerStack stack(4);
+    
+    uint32_t index = 0;
+    EXPECT_FALSE(stack.pop(index));
+    
+    stack.push(1);
+    stack.push(3);
+    stack.push(1); // already in the stack: moves to the top
+    stack.push(2);
+    
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 2);
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 1);
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 3);
+    EXPECT_FALSE(stack.pop(index));
+    
+    stack.push(3);
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 3);
+}
+
+TEST(ExecutionPool, IdleWorkerStack_Remove)
+{
+    execq::impl::IdleWorkerStack stack(4);
+    
+    stack.push(0);
+    stack.push(1);
+    stack.push(2);
+    stack.remove(2);
+    stack.remove(0);
+    
+    // Removed workers are skipped
+    uint32_t index = 0;
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 1);
+    EXPECT_FALSE(stack.pop(index));
+    
+    // Removing a worker that is not in the stack is a no-op
+    stack.remove(3);
+    stack.push(3);
+    stack.remove(3);
+    stack.remove(3);
+    EXPECT_FALSE(stack.pop(index));
+}
+
+TEST(ExecutionPool, IdleWorkerStack_PushMovesToTop)
+{
+    execq::impl::IdleWorkerStack stack(4);
+    
+    stack.push(0);
+    stack.push(1);
+    stack.push(2);
+    
+    // Worker #0 idles again without being popped: it is the most recently idled one now
+    stack.push(0);
+    stack.push(1);
+    
+    uint32_t index = 0;
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 1);
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 0);
+    EXPECT_TRUE(stack.pop(index));
+    EXPECT_EQ(index, 2);
+    EXPECT_FALSE(stack.pop(index));
+}
+
+TEST(ExecutionPool, IdleWorkerStack_Concurrent)
+{
+    const uint32_t workerCount = 8;
+    execq::impl::IdleWorkerStack stack(workerCount);
+    
+    std::atomic<uint32_t> popCounts[workerCount];
+    for (auto& count : popCounts)
+    {
+        count = 0;
+    }
+    
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        threads.emplace_back([&stack, &popCounts, i] {
+            for (int j = 0; j < 1000; j++)
+            {
+                stack.push(i);
+                uint32_t index = 0;
+                if (stack.pop(index))
+                {
+                    popCounts[index]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    
+    // Every index is handed out at most once per push, the rest is still in the stack
+    uint32_t index = 0;
+    std::vector<bool> left(workerCount, false);
+    while (stack.pop(index))
+    {
+        ASSERT_LT(index, workerCount);
+        EXPECT_FALSE(left[index]);
+        left[index] = true;
+    }
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        EXPECT_LE(popCounts[i], 1000);
+    }
+}
+
+TEST(ExecutionPool, NotifyOneWorker_PrefersLastIdle)
+{
+    execq::test::MockThreadWorkerFactory factory;
+    TestWorkers testWorkers(factory);
+    
+    execq::impl::ExecutionPool pool(3, factory);
+    ASSERT_EQ(testWorkers.workers.size(), 3);
+    
+    // All workers start idle, the first one is woken first
+    EXPECT_CALL(*testWorkers.workers[0], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+    EXPECT_CALL(*testWorkers.workers[1], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+    EXPECT_CALL(*testWorkers.workers[2], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+    
+    // Workers 1 and 2 run out of tasks: the one idle last is woken first
+    EXPECT_FALSE(testWorkers.providers[1]->nextTask().valid());
+    EXPECT_FALSE(testWorkers.providers[2]->nextTask().valid());
+    
+    EXPECT_CALL(*testWorkers.workers[2], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+    
+    // Worker 1 has already been woken by someone else, so it is skipped
+    EXPECT_FALSE(testWorkers.providers[0]->nextTask().valid());
+    EXPECT_CALL(*testWorkers.workers[0], notifyWorker()).WillOnce(Return(false));
+    EXPECT_CALL(*testWorkers.workers[1], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+}
+
+TEST(ExecutionPool, NotifyOneWorker_NoIdleWorkers)
+{
+    execq::test::MockThreadWorkerFactory factory;
+    TestWorkers testWorkers(factory);
+    
+    execq::impl::ExecutionPool pool(2, factory);
+    ASSERT_EQ(testWorkers.workers.size(), 2);
+    
+    EXPECT_CALL(*testWorkers.workers[0], notifyWorker()).WillOnce(Return(true));
+    EXPECT_CALL(*testWorkers.workers[1], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+    EXPECT_TRUE(pool.notifyOneWorker());
+    
+    // Stack is empty: busy workers are not asked, the caller uses its additional worker
+    EXPECT_CALL(*testWorkers.workers[0], notifyWorker()).Times(0);
+    EXPECT_CALL(*testWorkers.workers[1], notifyWorker()).Times(0);
+    EXPECT_FALSE(pool.notifyOneWorker());
+}
+
+TEST(ExecutionPool, NotifyOneWorker_SkipsWorkerBusyAfterNotifyAll)
+{
+    execq::test::MockThreadWorkerFactory factory;
+    TestWorkers testWorkers(factory);
+    
+    execq::impl::ExecutionPool pool(2, factory);
+    ASSERT_EQ(testWorkers.workers.size(), 2);
+    
+    MockTaskProvider provider;
+    pool.addProvider(provider);
+    
+    // Both workers are woken without being popped from the idle stack
+    EXPECT_CALL(*testWorkers.workers[0], notifyWorker()).WillOnce(Return(true));
+    EXPECT_CALL(*testWorkers.workers[1], notifyWorker()).WillOnce(Return(true));
+    pool.notifyAllWorkers();
+    
+    // Worker #0 takes a long task, worker #1 finds nothing and parks
+    EXPECT_CALL(provider, nextTask())
+    .WillOnce([] { return execq::impl::Task([] {}); })
+    .WillOnce([] { return execq::impl::Task(); });
+    EXPECT_TRUE(testWorkers.providers[0]->nextTask().valid());
+    EXPECT_FALSE(testWorkers.providers[1]->nextTask().valid());
+    
+    // New task must go to the parked worker, not to the busy one that would accept the notification
+    EXPECT_CALL(*testWorkers.workers[0], notifyWorker()).Times(0);
+    EXPECT_CALL(*testWorkers.workers[1], notifyWorker()).WillOnce(Return(true));
+    EXPECT_TRUE(pool.notifyOneWorker());
+    
+    pool.removeProvider(provider);
+}
+
+TEST(ExecutionPool, HighPriorityProvidersFirst)
+{
+    execq::test::MockThreadWorkerFactory factory;
+    TestWorkers testWorkers(factory);
+    
+    execq::impl::ExecutionPool pool(2, factory);
+    ASSERT_EQ(testWorkers.providers.size(), 2);
+    
+    execq::SchedulingOptions highPriority;
+    highPriority.priority = execq::Priority::High;
+    
+    MockTaskProvider normalProvider;
+    MockTaskProvider highPriorityProvider(highPriority);
+    pool.addProvider(normalProvider);
+    pool.addProvider(highPriorityProvider);
+    
+    // Normal provider is asked only when the high priority one has no tasks
+    ::testing::InSequence sequence;
+    EXPECT_CALL(highPriorityProvider, nextTask()).WillOnce([] { return execq::impl::Task([] {}); });
+    EXPECT_CALL(highPriorityProvider, nextTask()).WillOnce([] { return execq::impl::Task([] {}); });
+    EXPECT_CALL(highPriorityProvider, nextTask()).WillOnce([] { return execq::impl::Task(); });
+    EXPECT_CALL(normalProvider, nextTask()).WillOnce([] { return execq::impl::Task([] {}); });
+    
+    EXPECT_TRUE(testWorkers.providers[0]->nextTask().valid());
+    EXPECT_TRUE(testWorkers.providers[1]->nextTask().valid());
+    EXPECT_TRUE(testWorkers.providers[0]->nextTask().valid());
+    
+    EXPECT_EQ(highPriorityProvider.servedTaskCount(), 2);
+    EXPECT_EQ(normalProvider.servedTaskCount(), 1);
+    
+    pool.removeProvider(normalProvider);
+    pool.removeProvider(highPriorityProvider);
+}
+
+TEST(ExecutionPool, SharedOverflowThreads_QueuesProgressWhenPoolIsBusy)
+{
+    execq::PoolOptions options;
+    options.overflowPolicy = execq::OverflowPolicy::SharedThreads;
+    options.maxOverflowThreads = 1;
+    auto pool = execq::CreateExecutionPool(2, options);
+    
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_int blockedCount { 0 };
+    auto blockers = execq::CreateConcurrentExecutionQueue<void, int>(pool, [&] (const std::atomic_bool&, int) {
+        blockedCount++;
+        released.wait();
+    });
+    
+    blockers->push(0);
+    blockers->push(0);
+    while (blockedCount < 2)
+    {
+        std::this_thread::yield();
+    }
+    
+    // Single shared overflow thread serves all the queues in turn
+    std::vector<std::unique_ptr<execq::IExecutionQueue<int(int)>>> queues;
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 10; i++)
+    {
+        queues.push_back(execq::CreateSerialExecutionQueue<int, int>(pool, [] (const std::atomic_bool&, int object) {
+            return object;
+        }));
+        results.push_back(queues.back()->push(i));
+    }
+    
+    // Busy pool threads don't take notifications, all the queues go to the overflow thread
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_EQ(results[i].wait_for(execq::test::kTimeout), std::future_status::ready);
+        EXPECT_EQ(results[i].get(), i);
+    }
+    
+    release.set_value();
+}
+
+TEST(ExecutionPool, SharedOverflowThreads_DefaultLimitIsPoolThreadCount)
+{
+    auto pool = execq::CreateExecutionPool(2, execq::PoolOptions());
+    
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_int blockedCount { 0 };
+    
+    // Both pool threads and both shared threads are blocked
+    std::vector<std::unique_ptr<execq::IExecutionQueue<void(int)>>> blockers;
+    for (int i = 0; i < 4; i++)
+    {
+        blockers.push_back(execq::CreateSerialExecutionQueue<void, int>(pool, [&] (const std::atomic_bool&, int) {
+            blockedCount++;
+            released.wait();
+        }));
+        blockers.back()->push(0);
+    }
+    while (blockedCount < 4)
+    {
+        std::this_thread::yield();
+    }
+    
+    auto queue = execq::CreateSerialExecutionQueue<int, int>(pool, [] (const std::atomic_bool&, int object) {
+        return object;
+    });
+    std::future<int> result = queue->push(1);
+    EXPECT_EQ(result.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+    
+    release.set_value();
+    ASSERT_EQ(result.wait_for(execq::test::kTimeout), std::future_status::ready);
+    EXPECT_EQ(result.get(), 1);
+}
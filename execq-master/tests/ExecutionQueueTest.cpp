@@ -100,6 +100,50 @@ TEST(ExecutionPool, ExecutionQueue_TaskExecutionWhenQueueDestroyed)
     EXPECT_EQ(executeState.second, "qwe");
 }
 
+TEST(ExecutionPool, ExecutionQueue_SerialOrder)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    std::vector<uint32_t> executed;
+    auto queue = execq::CreateSerialExecutionQueue<void, uint32_t>(pool, [&executed] (const std::atomic_bool&, uint32_t&& object) {
+        executed.push_back(object);
+    });
+    
+    const uint32_t count = 1000;
+    std::future<void> last;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        last = queue->push(i);
+    }
+    ASSERT_TRUE(last.wait_for(kTimeout) == std::future_status::ready);
+    
+    ASSERT_EQ(executed.size(), count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        EXPECT_EQ(executed[i], i);
+    }
+}
+
+TEST(ExecutionPool, ExecutionQueue_ExecutorThrows)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    auto queue = execq::CreateConcurrentExecutionQueue<int, int>(pool, [] (const std::atomic_bool&, int&& object) {
+        if (object < 0)
+        {
+            throw std::invalid_argument("negative");
+        }
+        return object;
+    });
+    
+    // Exception is delivered through the future and the queue keeps working
+    std::future<int> failed = queue->push(-1);
+    EXPECT_THROW(failed.get(), std::invalid_argument);
+    
+    std::future<int> succeeded = queue->push(1);
+    EXPECT_EQ(succeeded.get(), 1);
+}
+
 TEST(ExecutionPool, ExecutionQueue_ExecutionPool_Concurrent)
 {
     auto executionPool = std::make_shared<MockExecutionPool>();
@@ -226,6 +270,176 @@ TEST(ExecutionPool, ExecutionQueue_ExecutionPool_Serial)
     .WillOnce(::testing::Return());
 }
 
+TEST(ExecutionPool, ExecutionQueue_ExecutionPool_Batch)
+{
+    auto executionPool = std::make_shared<::testing::NiceMock<MockExecutionPool>>();
+    MockThreadWorkerFactory workerFactory {};
+    
+    execq::impl::ITaskProvider* registeredProvider = nullptr;
+    EXPECT_CALL(*executionPool, addProvider(SaveArgAddress(&registeredProvider)))
+    .WillOnce(::testing::Return());
+    ON_CALL(*executionPool, notifyOneWorker())
+    .WillByDefault(::testing::Return(true));
+    
+    EXPECT_CALL(workerFactory, createWorker(::testing::_))
+    .WillOnce(::testing::Return(::testing::ByMove(std::unique_ptr<MockThreadWorker>(new ::testing::NiceMock<MockThreadWorker>{}))));
+    
+    execq::QueueOptions options;
+    options.batchSize = 3;
+    
+    std::vector<std::string> executed;
+    execq::impl::ExecutionQueue<void, std::string> queue(true, executionPool, workerFactory, [&executed] (const std::atomic_bool&, std::string&& object) {
+        executed.push_back(object);
+    }, options);
+    ASSERT_NE(registeredProvider, nullptr);
+    
+    for (const char* object : { "1", "2", "3", "4", "5" })
+    {
+        queue.push(object);
+    }
+    
+    // One task processes up to 'batchSize' objects, the rest is left for the next turn
+    execq::impl::Task task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    EXPECT_EQ(executed, std::vector<std::string>({ "1", "2", "3" }));
+    
+    task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    EXPECT_EQ(executed, std::vector<std::string>({ "1", "2", "3", "4", "5" }));
+    
+    EXPECT_FALSE(registeredProvider->nextTask().valid());
+}
+
+TEST(ExecutionPool, ExecutionQueue_ExecutionPool_BatchDuration)
+{
+    auto executionPool = std::make_shared<::testing::NiceMock<MockExecutionPool>>();
+    MockThreadWorkerFactory workerFactory {};
+    
+    execq::impl::ITaskProvider* registeredProvider = nullptr;
+    EXPECT_CALL(*executionPool, addProvider(SaveArgAddress(&registeredProvider)))
+    .WillOnce(::testing::Return());
+    ON_CALL(*executionPool, notifyOneWorker())
+    .WillByDefault(::testing::Return(true));
+    
+    EXPECT_CALL(workerFactory, createWorker(::testing::_))
+    .WillOnce(::testing::Return(::testing::ByMove(std::unique_ptr<MockThreadWorker>(new ::testing::NiceMock<MockThreadWorker>{}))));
+    
+    execq::QueueOptions options;
+    options.batchSize = 100;
+    options.batchDuration = std::chrono::microseconds(1);
+    
+    size_t executed = 0;
+    execq::impl::ExecutionQueue<void, int> queue(false, executionPool, workerFactory, [&executed] (const std::atomic_bool&, int&&) {
+        WaitForLongTermJob();
+        executed++;
+    }, options);
+    ASSERT_NE(registeredProvider, nullptr);
+    
+    queue.push(1);
+    queue.push(2);
+    
+    // Each object takes longer than 'batchDuration', so the batch ends after the first one
+    execq::impl::Task task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    EXPECT_EQ(executed, 1);
+    
+    task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    EXPECT_EQ(executed, 2);
+}
+
+TEST(ExecutionPool, ExecutionQueue_ExecutionPool_BatchTakenAtOnce)
+{
+    auto executionPool = std::make_shared<::testing::NiceMock<MockExecutionPool>>();
+    MockThreadWorkerFactory workerFactory {};
+    
+    execq::impl::ITaskProvider* registeredProvider = nullptr;
+    EXPECT_CALL(*executionPool, addProvider(SaveArgAddress(&registeredProvider)))
+    .WillOnce(::testing::Return());
+    ON_CALL(*executionPool, notifyOneWorker())
+    .WillByDefault(::testing::Return(true));
+    
+    EXPECT_CALL(workerFactory, createWorker(::testing::_))
+    .WillOnce(::testing::Return(::testing::ByMove(std::unique_ptr<MockThreadWorker>(new ::testing::NiceMock<MockThreadWorker>{}))));
+    
+    execq::QueueOptions options;
+    options.batchSize = 3;
+    
+    std::vector<bool> hasTaskDuringBatch;
+    std::vector<execq::impl::Task> otherTasks;
+    execq::impl::ExecutionQueue<void, int> queue(false, executionPool, workerFactory, [&] (const std::atomic_bool&, int&&) {
+        execq::impl::Task other = registeredProvider->nextTask();
+        hasTaskDuringBatch.push_back(other.valid());
+        if (other.valid())
+        {
+            otherTasks.push_back(std::move(other));
+        }
+    }, options);
+    ASSERT_NE(registeredProvider, nullptr);
+    
+    for (int object = 0; object < 3; object++)
+    {
+        queue.push(object);
+    }
+    
+    // All 3 objects are popped together: while they run, other workers find the queue empty
+    execq::impl::Task task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    for (execq::impl::Task& other : otherTasks)
+    {
+        other();
+    }
+    EXPECT_EQ(hasTaskDuringBatch, std::vector<bool>({ false, false, false }));
+}
+
+TEST(ExecutionPool, ExecutionQueue_ExecutionPool_BatchDurationKeepsOrder)
+{
+    auto executionPool = std::make_shared<::testing::NiceMock<MockExecutionPool>>();
+    MockThreadWorkerFactory workerFactory {};
+    
+    execq::impl::ITaskProvider* registeredProvider = nullptr;
+    EXPECT_CALL(*executionPool, addProvider(SaveArgAddress(&registeredProvider)))
+    .WillOnce(::testing::Return());
+    ON_CALL(*executionPool, notifyOneWorker())
+    .WillByDefault(::testing::Return(true));
+    
+    EXPECT_CALL(workerFactory, createWorker(::testing::_))
+    .WillOnce(::testing::Return(::testing::ByMove(std::unique_ptr<MockThreadWorker>(new ::testing::NiceMock<MockThreadWorker>{}))));
+    
+    execq::QueueOptions options;
+    options.batchSize = 100;
+    options.batchDuration = std::chrono::microseconds(1);
+    
+    std::vector<std::string> executed;
+    execq::impl::ExecutionQueue<void, std::string> queue(true, executionPool, workerFactory, [&executed] (const std::atomic_bool&, std::string&& object) {
+        WaitForLongTermJob();
+        executed.push_back(object);
+    }, options);
+    ASSERT_NE(registeredProvider, nullptr);
+    
+    queue.push("1");
+    queue.push("2");
+    queue.push("3");
+    
+    // Objects not reached before the deadline go back to the front of the queue
+    execq::impl::Task task = registeredProvider->nextTask();
+    ASSERT_TRUE(task.valid());
+    task();
+    EXPECT_EQ(executed, std::vector<std::string>({ "1" }));
+    
+    queue.push("4");
+    while ((task = registeredProvider->nextTask()).valid())
+    {
+        task();
+    }
+    EXPECT_EQ(executed, std::vector<std::string>({ "1", "2", "3", "4" }));
+}
+
 TEST(ExecutionPool, ExecutionQueue_Cancelability)
 {
     auto executionPool = std::make_shared<MockExecutionPool>();
@@ -280,3 +494,104 @@ TEST(ExecutionPool, ExecutionQueue_Cancelability)
     EXPECT_CALL(*executionPool, removeProvider(::testing::_))
     .WillOnce(::testing::Return());
 }
+
+TEST(ExecutionPool, ExecutionQueue_CancelFromRunningTasks)
+{
+    // More running generations than the cancel flag slots, each task cancels its own generation
+    const int taskCount = 12;
+    auto pool = execq::CreateExecutionPool(taskCount);
+    
+    std::atomic<int> cancelCount { 0 };
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::unique_ptr<execq::IExecutionQueue<bool(int)>> queue;
+    queue = execq::CreateConcurrentExecutionQueue<bool, int>(pool, [&] (const std::atomic_bool& isCanceled, int) {
+        queue->cancel();
+        cancelCount++;
+        released.wait();
+        return isCanceled.load();
+    });
+    
+    std::vector<std::future<bool>> results;
+    for (int i = 0; i < taskCount; i++)
+    {
+        results.push_back(queue->push(i));
+        
+        // Next object goes to the next generation
+        const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        while (cancelCount <= i && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(cancelCount, i + 1);
+    }
+    
+    release.set_value();
+    for (auto& result : results)
+    {
+        ASSERT_EQ(result.wait_for(kTimeout), std::future_status::ready);
+        EXPECT_TRUE(result.get());
+    }
+}
+
+TEST(ExecutionPool, ExecutionQueue_PushAfter)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    std::vector<uint32_t> executed;
+    auto queue = execq::CreateSerialExecutionQueue<std::chrono::steady_clock::time_point, uint32_t>(pool, [&executed] (const std::atomic_bool& isCanceled, uint32_t&& object) {
+        EXPECT_FALSE(isCanceled);
+        executed.push_back(object);
+        return std::chrono::steady_clock::now();
+    });
+    
+    // Delayed objects are processed by their time, not by push order
+    const auto pushTime = std::chrono::steady_clock::now();
+    auto second = queue->pushAfter(kLongTermJob * 2, 2);
+    auto first = queue->pushAt(pushTime + kLongTermJob, 1);
+    auto immediate = queue->pushAfter(std::chrono::milliseconds(0), 0);
+    
+    ASSERT_EQ(second.wait_for(kTimeout), std::future_status::ready);
+    EXPECT_GE(immediate.get(), pushTime);
+    EXPECT_GE(first.get(), pushTime + kLongTermJob);
+    EXPECT_GE(second.get(), pushTime + kLongTermJob * 2);
+    EXPECT_EQ(executed, std::vector<uint32_t>({ 0, 1, 2 }));
+}
+
+TEST(ExecutionPool, ExecutionQueue_PushAfter_Cancelability)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    ::testing::MockFunction<void(const std::atomic_bool&, std::string&&)> mockExecutor;
+    auto queue = execq::CreateConcurrentExecutionQueue(pool, mockExecutor.AsStdFunction());
+    
+    EXPECT_CALL(mockExecutor, Call(CompareWithAtomic(true), CompareRvalue("qwe")))
+    .WillOnce(::testing::Return());
+    EXPECT_CALL(mockExecutor, Call(CompareWithAtomic(false), CompareRvalue("asd")))
+    .WillOnce(::testing::Return());
+    
+    // Objects pushed before 'cancel' are canceled even if not due yet
+    auto canceled = queue->pushAfter(kLongTermJob, "qwe");
+    queue->cancel();
+    auto notCanceled = queue->pushAfter(kLongTermJob, "asd");
+    
+    EXPECT_EQ(canceled.wait_for(kTimeout), std::future_status::ready);
+    EXPECT_EQ(notCanceled.wait_for(kTimeout), std::future_status::ready);
+}
+
+TEST(ExecutionPool, ExecutionQueue_PushAfter_QueueDestroyed)
+{
+    auto pool = execq::CreateExecutionPool();
+    
+    ::testing::MockFunction<void(const std::atomic_bool&, std::string&&)> mockExecutor;
+    auto queue = execq::CreateSerialExecutionQueue(pool, mockExecutor.AsStdFunction());
+    
+    EXPECT_CALL(mockExecutor, Call(CompareWithAtomic(true), CompareRvalue("qwe")))
+    .WillOnce(::testing::Return());
+    
+    // Pending objects are processed as canceled without waiting for their time
+    auto result = queue->pushAfter(std::chrono::hours(1), "qwe");
+    queue.reset();
+    
+    EXPECT_EQ(result.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+}
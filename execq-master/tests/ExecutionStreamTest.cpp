@@ -113,3 +113,69 @@ TEST(ExecutionPool, ExecutionStream_WorkerPool)
     EXPECT_CALL(*executionPool, removeProvider(::testing::_))
     .WillOnce(::testing::Return());
 }
+
+TEST(ExecutionPool, ExecutionStream_MaxConcurrency)
+{
+    auto executionPool = std::make_shared<::testing::NiceMock<execq::test::MockExecutionPool>>();
+    MockThreadWorkerFactory workerFactory {};
+    
+    execq::impl::ITaskProvider* registeredProvider = nullptr;
+    EXPECT_CALL(*executionPool, addProvider(SaveArgAddress(&registeredProvider)))
+    .WillOnce(::testing::Return());
+    EXPECT_CALL(workerFactory, createWorker(::testing::_))
+    .WillOnce(::testing::Return(::testing::ByMove(std::unique_ptr<MockThreadWorker>(new ::testing::NiceMock<MockThreadWorker>{}))));
+    
+    ::testing::NiceMock<::testing::MockFunction<void(const std::atomic_bool&)>> mockExecutor;
+    execq::StreamOptions options;
+    options.maxConcurrency = 2;
+    execq::impl::ExecutionStream stream(executionPool, workerFactory, mockExecutor.AsStdFunction(), options);
+    ASSERT_NE(registeredProvider, nullptr);
+    
+    stream.start();
+    
+    // No more than two tasks at once
+    execq::impl::Task task1 = registeredProvider->nextTask();
+    execq::impl::Task task2 = registeredProvider->nextTask();
+    EXPECT_TRUE(task1.valid());
+    EXPECT_TRUE(task2.valid());
+    EXPECT_FALSE(registeredProvider->nextTask().valid());
+    
+    // Finished task frees its slot
+    task1();
+    execq::impl::Task task3 = registeredProvider->nextTask();
+    EXPECT_TRUE(task3.valid());
+    EXPECT_FALSE(registeredProvider->nextTask().valid());
+    
+    stream.stop();
+    
+    // Stream waits for handed out tasks when destroyed
+    task2();
+    task3();
+}
+
+TEST(ExecutionPool, ExecutionStream_MaxConcurrencyInPool)
+{
+    auto pool = execq::CreateExecutionPool(4);
+    
+    std::atomic_int running { 0 };
+    std::atomic_int maxRunning { 0 };
+    std::atomic_int executedCount { 0 };
+    execq::StreamOptions options;
+    options.maxConcurrency = 2;
+    auto stream = execq::CreateExecutionStream(pool, [&] (const std::atomic_bool&) {
+        const int nowRunning = ++running;
+        int expected = maxRunning;
+        while (nowRunning > expected && !maxRunning.compare_exchange_weak(expected, nowRunning))
+        {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        executedCount++;
+        running--;
+    }, options);
+    
+    stream->start();
+    WaitForLongTermJob();
+    stream->stop();
+    
+    EXPECT_GT(executedCount, 0);
+    EXPECT_LE(maxRunning, 2);
+}
@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "RingQueue.h"
+
+#include <gtest/gtest.h>
+
+TEST(RingQueue, FifoAcrossGrowth)
+{
+    execq::impl::RingQueue<std::unique_ptr<int>> queue;
+    EXPECT_TRUE(queue.empty());
+    
+    // Interleave pushes and pops so the buffer wraps around before it grows
+    int pushed = 0;
+    int popped = 0;
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < 10 + round * 5; i++)
+        {
+            queue.emplace(new int(pushed++));
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            ASSERT_FALSE(queue.empty());
+            EXPECT_EQ(*queue.front(), popped++);
+            queue.pop();
+        }
+    }
+    
+    EXPECT_EQ(queue.size(), static_cast<size_t>(pushed - popped));
+    while (!queue.empty())
+    {
+        EXPECT_EQ(*queue.front(), popped++);
+        queue.pop();
+    }
+    EXPECT_EQ(popped, pushed);
+}
+
+TEST(RingQueue, EmplaceFront)
+{
+    execq::impl::RingQueue<std::unique_ptr<int>> queue;
+    
+    // Front insertion wraps the head below zero and keeps working across growth
+    for (int i = 0; i < 20; i++)
+    {
+        queue.emplace(new int(i));
+    }
+    for (int i = -1; i >= -20; i--)
+    {
+        queue.emplaceFront(new int(i));
+    }
+    
+    for (int expected = -20; expected < 20; expected++)
+    {
+        ASSERT_FALSE(queue.empty());
+        EXPECT_EQ(*queue.front(), expected);
+        queue.pop();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(RingQueue, DestroysRemainingObjects)
+{
+    std::shared_ptr<int> object = std::make_shared<int>(0);
+    {
+        execq::impl::RingQueue<std::shared_ptr<int>> queue;
+        for (int i = 0; i < 100; i++)
+        {
+            queue.emplace(object);
+        }
+        EXPECT_EQ(object.use_count(), 101);
+    }
+    EXPECT_EQ(object.use_count(), 1);
+}
@@ -26,14 +26,16 @@
 #include "ExecqTestUtil.h"
 
 using namespace ::testing;
+using execq::test::MockTaskProvider;
 
 namespace
 {
-    class MockTaskProvider: public execq::impl::ITaskProvider
+    execq::SchedulingOptions MakeWeight(const uint32_t weight)
     {
-    public:
-        MOCK_METHOD0(nextTask, execq::impl::Task());
-    };
+        execq::SchedulingOptions options;
+        options.weight = weight;
+        return options;
+    }
     
     execq::impl::Task MakeValidTask()
     {
@@ -106,6 +108,63 @@ TEST(ExecutionPool, TaskProviderList_MultipleItems)
     EXPECT_FALSE(providers.nextTask().valid());
 }
 
+TEST(ExecutionPool, TaskProviderList_Weights)
+{
+    execq::impl::TaskProviderList providers;
+    
+    MockTaskProvider provider1(MakeWeight(3));
+    providers.addProvider(provider1);
+    
+    MockTaskProvider provider2;
+    providers.addProvider(provider2);
+    
+    MockTaskProvider provider3(MakeWeight(0)); // treated as 1
+    providers.addProvider(provider3);
+    
+    EXPECT_CALL(provider1, nextTask())
+    .WillRepeatedly([] { return MakeValidTask(); });
+    EXPECT_CALL(provider2, nextTask())
+    .WillRepeatedly([] { return MakeValidTask(); });
+    EXPECT_CALL(provider3, nextTask())
+    .WillRepeatedly([] { return MakeValidTask(); });
+    
+    // Each round gives 3 tasks to provider #1 and 1 task to #2 and #3
+    for (int i = 0; i < 50; i++)
+    {
+        ASSERT_TRUE(providers.nextTask().valid());
+    }
+    
+    EXPECT_EQ(provider1.servedTaskCount(), 30);
+    EXPECT_EQ(provider2.servedTaskCount(), 10);
+    EXPECT_EQ(provider3.servedTaskCount(), 10);
+}
+
+TEST(ExecutionPool, TaskProviderList_WeightedProviderDrained)
+{
+    execq::impl::TaskProviderList providers;
+    
+    MockTaskProvider provider1(MakeWeight(4));
+    providers.addProvider(provider1);
+    
+    MockTaskProvider provider2;
+    providers.addProvider(provider2);
+    
+    // Provider #1 runs out of tasks before its quantum is used: the turn goes to #2
+    EXPECT_CALL(provider1, nextTask())
+    .WillOnce([] { return MakeValidTask(); })
+    .WillRepeatedly([] { return MakeInvalidTask(); });
+    EXPECT_CALL(provider2, nextTask())
+    .WillRepeatedly([] { return MakeValidTask(); });
+    
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(providers.nextTask().valid());
+    }
+    
+    EXPECT_EQ(provider1.servedTaskCount(), 1);
+    EXPECT_EQ(provider2.servedTaskCount(), 2);
+}
+
 TEST(ExecutionPool, TaskProviderList_Add_Remove)
 {
     execq::impl::TaskProviderList providers;
@@ -136,6 +195,130 @@ TEST(ExecutionPool, TaskProviderList_Add_Remove)
     EXPECT_FALSE(providers.nextTask().valid());
 }
 
+TEST(ExecutionPool, TaskProviderList_SkipsDrainedProviders)
+{
+    execq::impl::TaskProviderList providers;
+    
+    MockTaskProvider provider;
+    providers.addProvider(provider);
+    
+    // Provider without tasks is not asked again until it is marked ready
+    EXPECT_CALL(provider, nextTask())
+    .WillOnce([] { return MakeInvalidTask(); });
+    
+    EXPECT_FALSE(providers.nextTask().valid());
+    EXPECT_FALSE(providers.nextTask().valid());
+    
+    
+    EXPECT_CALL(provider, nextTask())
+    .WillOnce([] { return MakeValidTask(); })
+    .WillOnce([] { return MakeInvalidTask(); });
+    
+    provider.markReady();
+    EXPECT_TRUE(providers.nextTask().valid());
+    EXPECT_FALSE(providers.nextTask().valid());
+    EXPECT_FALSE(providers.nextTask().valid());
+}
+
+TEST(ExecutionPool, TaskProviderList_ManyProviders)
+{
+    execq::impl::TaskProviderList providers;
+    
+    // More providers than fit into one chunk, every one of them has a single task
+    std::vector<std::unique_ptr<MockTaskProvider>> mocks(150);
+    for (auto& provider : mocks)
+    {
+        provider.reset(new MockTaskProvider);
+        providers.addProvider(*provider);
+    }
+    
+    // Removed slots are reused
+    providers.removeProvider(*mocks[10]);
+    providers.removeProvider(*mocks[100]);
+    for (size_t i = 0; i < mocks.size(); i++)
+    {
+        if (i == 10 || i == 100)
+        {
+            EXPECT_CALL(*mocks[i], nextTask())
+            .Times(0);
+        }
+        else
+        {
+            EXPECT_CALL(*mocks[i], nextTask())
+            .WillOnce([] { return MakeValidTask(); })
+            .WillRepeatedly([] { return MakeInvalidTask(); });
+        }
+    }
+    
+    MockTaskProvider added;
+    EXPECT_CALL(added, nextTask())
+    .WillOnce([] { return MakeValidTask(); })
+    .WillRepeatedly([] { return MakeInvalidTask(); });
+    providers.addProvider(added);
+    
+    for (size_t i = 0; i < mocks.size() - 2 + 1; i++)
+    {
+        EXPECT_TRUE(providers.nextTask().valid());
+    }
+    EXPECT_FALSE(providers.nextTask().valid());
+}
+
+TEST(ExecutionPool, TaskProviderList_RemoveWhileScheduling)
+{
+    class CountingProvider: public execq::impl::ITaskProvider
+    {
+    public:
+        virtual execq::impl::Task nextTask() final
+        {
+            calls++;
+            markReady();
+            return MakeValidTask();
+        }
+        
+        std::atomic_size_t calls { 0 };
+    };
+    
+    execq::impl::TaskProviderList providers;
+    std::atomic_bool stop { false };
+    
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; i++)
+    {
+        workers.emplace_back([&] {
+            while (!stop)
+            {
+                execq::impl::Task task = providers.nextTask();
+                if (task.valid())
+                {
+                    task();
+                }
+            }
+        });
+    }
+    
+    // Provider is destroyed right after removal, so workers must not touch it once removeProvider returns
+    for (int i = 0; i < 200; i++)
+    {
+        std::unique_ptr<CountingProvider> provider(new CountingProvider);
+        providers.addProvider(*provider);
+        while (!provider->calls)
+        {
+            std::this_thread::yield();
+        }
+        providers.removeProvider(*provider);
+        
+        const size_t calls = provider->calls;
+        std::this_thread::yield();
+        EXPECT_EQ(calls, provider->calls);
+    }
+    
+    stop = true;
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
 TEST(ExecutionPool, ThreadWorkerPool_NotifyWorkers_Single)
 {
     using namespace execq::impl;
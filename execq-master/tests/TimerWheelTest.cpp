@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Alkenso (Vladimir Vashurkin)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TimerWheel.h"
+
+#include <gmock/gmock.h>
+
+#include <future>
+
+namespace
+{
+    class TestTimer: public execq::impl::TimerWheel::Timer
+    {
+    public:
+        TestTimer(std::function<void()> onFire, const void* owner = nullptr)
+        : m_onFire(std::move(onFire))
+        , m_owner(owner)
+        {}
+        
+        virtual void fire() final
+        {
+            m_onFire();
+        }
+        
+        virtual const void* owner() const final
+        {
+            return m_owner;
+        }
+        
+    private:
+        const std::function<void()> m_onFire;
+        const void* m_owner = nullptr;
+    };
+    
+    std::unique_ptr<execq::impl::TimerWheel::Timer> MakeTimer(std::function<void()> onFire, const void* owner = nullptr)
+    {
+        return std::unique_ptr<execq::impl::TimerWheel::Timer>(new TestTimer(std::move(onFire), owner));
+    }
+}
+
+TEST(TimerWheel, FiresInDueOrder)
+{
+    // Small wheel: timers wrap around it several times
+    execq::impl::TimerWheel wheel(std::chrono::milliseconds(1), 16);
+    
+    std::mutex mutex;
+    std::vector<int> fired;
+    std::promise<void> lastFired;
+    
+    const auto now = std::chrono::steady_clock::now();
+    const std::vector<int> delays = { 70, 5, 40, 0, 21, 100, 16 };
+    for (const int delay : delays)
+    {
+        const auto dueTime = now + std::chrono::milliseconds(delay);
+        wheel.schedule(MakeTimer([&, delay, dueTime] {
+            EXPECT_GE(std::chrono::steady_clock::now(), dueTime);
+            
+            std::lock_guard<std::mutex> lock(mutex);
+            fired.push_back(delay);
+            if (fired.size() == delays.size())
+            {
+                lastFired.set_value();
+            }
+        }), dueTime);
+    }
+    
+    ASSERT_EQ(lastFired.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    EXPECT_EQ(fired, std::vector<int>({ 0, 5, 16, 21, 40, 70, 100 }));
+    EXPECT_EQ(wheel.pendingCount(), 0);
+}
+
+TEST(TimerWheel, Expire)
+{
+    execq::impl::TimerWheel wheel;
+    
+    int owner1 = 0;
+    int owner2 = 0;
+    int fired1 = 0;
+    int fired2 = 0;
+    
+    const auto dueTime = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    for (int i = 0; i < 100; i++)
+    {
+        wheel.schedule(MakeTimer([&] { fired1++; }, &owner1), dueTime + std::chrono::milliseconds(i));
+        wheel.schedule(MakeTimer([&] { fired2++; }, &owner2), dueTime + std::chrono::milliseconds(i));
+    }
+    
+    // Only timers of the owner are fired, right away
+    wheel.expire(&owner1);
+    EXPECT_EQ(fired1, 100);
+    EXPECT_EQ(fired2, 0);
+    EXPECT_EQ(wheel.pendingCount(), 100);
+}
+
+TEST(TimerWheel, FiredTimerMaySchedule)
+{
+    execq::impl::TimerWheel wheel;
+    
+    std::promise<void> secondFired;
+    wheel.schedule(MakeTimer([&] {
+        wheel.schedule(MakeTimer([&] { secondFired.set_value(); }), std::chrono::steady_clock::now());
+    }), std::chrono::steady_clock::now());
+    
+    ASSERT_EQ(secondFired.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+}
+
+TEST(TimerWheel, ExpireWaitsTimerBeingFired)
+{
+    execq::impl::TimerWheel wheel;
+    
+    int owner = 0;
+    std::promise<void> fireStarted;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic_bool fireFinished { false };
+    wheel.schedule(MakeTimer([&] {
+        fireStarted.set_value();
+        released.wait();
+        fireFinished = true;
+    }, &owner), std::chrono::steady_clock::now());
+    
+    ASSERT_EQ(fireStarted.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    
+    auto expired = std::async(std::launch::async, [&] {
+        wheel.expire(&owner);
+        EXPECT_TRUE(fireFinished);
+    });
+    EXPECT_EQ(expired.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+    
+    release.set_value();
+    ASSERT_EQ(expired.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    EXPECT_EQ(wheel.pendingCount(), 0);
+}